@@ -74,6 +74,8 @@ class sha224
   void to_variant( const sha224& bi, variant& v );
   void from_variant( const variant& v, sha224& bi );
 
+  namespace raw { template<> struct has_trivial_raw_format<sha224> : std::true_type {}; }
+
 } // fc
 namespace std
 {
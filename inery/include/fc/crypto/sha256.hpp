@@ -106,6 +106,8 @@ class sha256
 
   uint64_t hash64(const char* buf, size_t len);    
 
+  namespace raw { template<> struct has_trivial_raw_format<sha256> : std::true_type {}; }
+
 } // fc
 
 namespace std
@@ -2,6 +2,7 @@
 #include <fc/utility.hpp>
 #include <string.h>
 #include <stdint.h>
+#include <vector>
 
 #include <boost/multiprecision/cpp_int.hpp>
 
@@ -91,6 +92,24 @@ class datastream<size_t> {
      size_t _size;
 };
 
+/**
+ *  Appends to a std::vector<char>, growing it as needed, so that an object can be
+ *  packed in a single pass instead of the "test run" followed by the actual write.
+ */
+template<>
+class datastream<std::vector<char>> {
+   public:
+     explicit datastream( std::vector<char>& buf ):_buf(buf){};
+     inline bool     skip( size_t s )                 { _buf.resize( _buf.size() + s ); return true; }
+     inline bool     write( const char* d, size_t s ) { _buf.insert( _buf.end(), d, d + s ); return true; }
+     inline bool     put(char c)                      { _buf.push_back( c ); return true; }
+     inline bool     valid()const                     { return true;              }
+     inline size_t   tellp()const                     { return _buf.size();       }
+     inline size_t   remaining()const                 { return 0;                 }
+  private:
+     std::vector<char>& _buf;
+};
+
 template<typename ST>
 inline datastream<ST>& operator<<(datastream<ST>& ds, const __int128& d) {
   ds.write( (const char*)&d, sizeof(d) );
@@ -11,6 +11,7 @@
 #include <fc/filesystem.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/safe.hpp>
+#include <fc/scoped_exit.hpp>
 #include <fc/io/raw_fwd.hpp>
 #include <array>
 #include <map>
@@ -21,6 +22,9 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <fc/crypto/hex.hpp>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 
 namespace fc {
     namespace raw {
@@ -201,28 +205,79 @@ namespace fc {
       if( b ) { v = std::make_shared<T>(); fc::raw::unpack( s, *v ); }
     } FC_RETHROW_EXCEPTIONS( warn, "std::shared_ptr<T>", ("type",fc::get_typename<T>::name()) ) }
 
+    namespace detail {
+      template<typename Stream> struct is_memory_datastream : std::false_type {};
+      template<typename T> struct is_memory_datastream<datastream<T*>> : std::true_type {};
+
+      /// throws as reading size bytes would, before the destination is sized for them; a no-op for other streams
+      template<typename Stream>
+      inline void check_remaining( const Stream& s, size_t size ) {
+        if constexpr( is_memory_datastream<Stream>::value ) {
+          if( size > s.remaining() )
+            fc::detail::throw_datastream_range_error( "read", s.tellp() + s.remaining(), int64_t(size - s.remaining()) );
+        }
+      }
+
+      /// encodes val as a varint into out, which must have room for 10 bytes; @return the encoded size
+      inline size_t encode_varint( uint64_t val, char* out ) {
+        size_t n = 0;
+        while( val >= 0x80 ) {
+          out[n++] = char( uint8_t(val) | 0x80 );
+          val >>= 7;
+        }
+        out[n++] = char( val );
+        return n;
+      }
+
+      /**
+       * Decodes the varint at p, which must have 8 readable bytes, with one load and without a branch per byte.
+       * Like the byte loop of unpack( Stream&, unsigned_int& ), at most max_bytes are read, and bits beyond
+       * the 32nd are dropped. @return the encoded size, 0 if the varint is longer than 8 bytes
+       */
+      inline size_t decode_varint32( const char* p, size_t max_bytes, uint32_t& value ) {
+        uint64_t word;
+        memcpy( &word, p, sizeof(word) );
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64( word );
+#endif
+        const uint64_t stops = ~word & 0x8080808080808080ull;
+        if( !stops ) return 0;
+        const size_t len = std::min<size_t>( (__builtin_ctzll( stops ) >> 3) + 1, max_bytes );
+        word &= ~0ull >> ( 64 - 8 * len ); // len <= 5
+#if defined(__BMI2__)
+        value = uint32_t( _pext_u64( word, 0x7f7f7f7f7full ) );
+#else
+        value = uint32_t(   ( word        & 0x7f )        | ( ( word >> 8  & 0x7f ) << 7 )  | ( ( word >> 16 & 0x7f ) << 14 )
+                          | ( ( word >> 24 & 0x7f ) << 21 ) | ( ( word >> 32 & 0x7f ) << 28 ) );
+#endif
+        return len;
+      }
+    }
+
     template<typename Stream> inline void pack( Stream& s, const signed_int& v ) {
       uint32_t val = (v.value<<1) ^ (v.value>>31);              //apply zigzag encoding
-      do {
-        uint8_t b = uint8_t(val) & 0x7f;
-        val >>= 7;
-        b |= ((val > 0) << 7);
-        s.write((char*)&b,1);//.put(b);
-      } while( val );
+      char buf[10];
+      s.write( buf, detail::encode_varint( val, buf ) );
     }
 
     template<typename Stream> inline void pack( Stream& s, const unsigned_int& v ) {
-      uint64_t val = v.value;
-      do {
-        uint8_t b = uint8_t(val) & 0x7f;
-        val >>= 7;
-        b |= ((val > 0) << 7);
-        s.write((char*)&b,1);//.put(b);
-      }while( val );
+      char buf[10];
+      s.write( buf, detail::encode_varint( v.value, buf ) );
     }
 
     template<typename Stream> inline void unpack( Stream& s, signed_int& vi ) {
-      uint32_t v = 0; char b = 0; int by = 0;
+      uint32_t v = 0;
+      if constexpr( detail::is_memory_datastream<Stream>::value ) {
+        size_t len;
+        // longer encodings keep the semantics of the byte loop below
+        if( s.remaining() >= sizeof(uint64_t) && ( len = detail::decode_varint32( s.pos(), 6, v ) ) && len <= 5 ) {
+          s.skip( len );
+          vi.value = (v>>1) ^ (~(v&1)+1ull);                     //reverse zigzag encoding
+          return;
+        }
+        v = 0;
+      }
+      char b = 0; int by = 0;
       do {
         s.get(b);
         v |= uint32_t(uint8_t(b) & 0x7f) << by;
@@ -232,6 +287,14 @@ namespace fc {
     }
 
     template<typename Stream> inline void unpack( Stream& s, unsigned_int& vi ) {
+      if constexpr( detail::is_memory_datastream<Stream>::value ) {
+        if( s.remaining() >= sizeof(uint64_t) ) {
+          if( size_t len = detail::decode_varint32( s.pos(), 5, vi.value ) ) {
+            s.skip( len );
+            return;
+          }
+        }
+      }
       uint64_t v = 0; char b = 0; uint8_t by = 0;
       do {
           s.get(b);
@@ -295,6 +358,7 @@ namespace fc {
     template<typename Stream> inline void unpack( Stream& s, std::vector<char>& value ) {
       unsigned_int size; fc::raw::unpack( s, size );
       FC_ASSERT( size.value <= MAX_SIZE_OF_BYTE_ARRAYS );
+      detail::check_remaining( s, size.value );
       value.resize(size.value);
       if( value.size() )
         s.read( value.data(), value.size() );
@@ -308,10 +372,29 @@ namespace fc {
     }
 
     template<typename Stream> inline void unpack( Stream& s, fc::string& v )  {
-      std::vector<char> tmp; fc::raw::unpack(s,tmp);
-      if( tmp.size() )
-         v = fc::string(tmp.data(),tmp.data()+tmp.size());
-      else v = fc::string();
+      unsigned_int size; fc::raw::unpack( s, size );
+      FC_ASSERT( size.value <= MAX_SIZE_OF_BYTE_ARRAYS );
+      detail::check_remaining( s, size.value );
+      v.resize( size.value );
+      if( size.value ) s.read( v.data(), size.value );
+    }
+
+    // std::string_view, packed like fc::string
+    template<typename Stream> inline void pack( Stream& s, const std::string_view& v )  {
+      FC_ASSERT( v.size() <= MAX_SIZE_OF_BYTE_ARRAYS );
+      fc::raw::pack( s, unsigned_int((uint32_t)v.size()));
+      if( v.size() ) s.write( v.data(), v.size() );
+    }
+
+    /// Unpacks without copying: v refers to the stream's buffer, which must outlive it.
+    template<typename Stream> inline void unpack( Stream& s, std::string_view& v )  {
+      static_assert( std::is_same<Stream, datastream<const char*>>::value,
+                     "std::string_view can only be unpacked from a datastream<const char*>" );
+      unsigned_int size; fc::raw::unpack( s, size );
+      FC_ASSERT( size.value <= MAX_SIZE_OF_BYTE_ARRAYS );
+      detail::check_remaining( s, size.value );
+      v = std::string_view( s.pos(), size.value );
+      s.skip( size.value );
     }
 
     // bip::basic_string
@@ -322,10 +405,13 @@ namespace fc {
     }
 
     template<typename Stream> inline void unpack( Stream& s, shared_string& v )  {
-      std::vector<char> tmp; fc::raw::unpack(s,tmp);
+      unsigned_int size; fc::raw::unpack( s, size );
+      FC_ASSERT( size.value <= MAX_SIZE_OF_BYTE_ARRAYS );
       FC_ASSERT(v.size() == 0);
-      if( tmp.size() ) {
-         v.append(tmp.begin(), tmp.end());
+      detail::check_remaining( s, size.value );
+      if( size.value ) {
+         v.resize( size.value );
+         s.read( &v[0], size.value );
       }
     }
 
@@ -341,6 +427,96 @@ namespace fc {
 
     namespace detail {
 
+      template<typename T>
+      constexpr bool is_memcpy_packable();
+
+      struct memcpy_size_visitor {
+        size_t& size;
+        bool&   packable;
+
+        template<typename T, typename C, T(C::*p)>
+        constexpr void operator()( const char* )const {
+          packable = packable && is_memcpy_packable<T>();
+          size += sizeof(T);
+        }
+      };
+
+      template<typename T> struct is_fixed_array : std::false_type {};
+      template<typename T, size_t N> struct is_fixed_array<fc::array<T,N>> : std::true_type { using element_type = T; static constexpr size_t size = N; };
+      template<typename T, size_t N> struct is_fixed_array<std::array<T,N>> : std::true_type { using element_type = T; static constexpr size_t size = N; };
+
+      /**
+       * True if the packed form of T has the size of T and its member types fit the packed form of their members,
+       * i.e. T has no padding and is built from scalars other than bool, unreflected enums, fixed arrays and types
+       * with a trivial raw format. Whether reflection order is declaration order is checked by has_memcpy_layout().
+       */
+      template<typename T>
+      constexpr bool is_memcpy_packable() {
+        if constexpr( std::is_same<T, bool>::value ) {
+          return false; // unpack validates the value
+        } else if constexpr( std::is_arithmetic<T>::value || std::is_enum<T>::value ) {
+          return !fc::reflector<T>::is_defined::value; // reflected enums are packed as int64_t
+        } else if constexpr( is_fixed_array<T>::value ) {
+          using E = typename is_fixed_array<T>::element_type;
+          return sizeof(T) == sizeof(E) * is_fixed_array<T>::size && is_memcpy_packable<E>();
+        } else if constexpr( has_trivial_raw_format<T>::value ) {
+          return true;
+        } else if constexpr( fc::reflector<T>::is_defined::value && std::is_class<T>::value ) {
+          if constexpr( !std::is_trivially_copyable<T>::value || !std::is_default_constructible<T>::value ||
+                        fc::has_reflector_init<T>::value ) {
+            return false;
+          } else {
+            size_t size = 0;
+            bool packable = true;
+            fc::reflector<T>::visit( memcpy_size_visitor{ size, packable } );
+            return packable && size == sizeof(T);
+          }
+        } else {
+          return false;
+        }
+      }
+
+      template<typename T>
+      bool has_memcpy_layout();
+
+      template<typename Class>
+      struct memcpy_offset_visitor {
+        const Class& obj;
+        size_t&      next;
+        bool&        in_order;
+
+        template<typename T, typename C, T(C::*p)>
+        void operator()( const char* )const {
+          const char* member = reinterpret_cast<const char*>( &(static_cast<const C&>( obj ).*p) );
+          in_order = in_order && size_t( member - reinterpret_cast<const char*>( &obj ) ) == next && has_memcpy_layout<T>();
+          next += sizeof(T);
+        }
+      };
+
+      /**
+       * True if T can be packed and unpacked by copying its bytes: is_memcpy_packable<T>() and the reflected members
+       * of T, and of its members, are listed in declaration order. The order is checked once per type.
+       */
+      template<typename T>
+      bool has_memcpy_layout() {
+        if constexpr( !is_memcpy_packable<T>() ) {
+          return false;
+        } else if constexpr( is_fixed_array<T>::value ) {
+          return has_memcpy_layout<typename is_fixed_array<T>::element_type>();
+        } else if constexpr( std::is_class<T>::value && !has_trivial_raw_format<T>::value ) {
+          static const bool in_order = []() {
+            const T obj{};
+            size_t next = 0;
+            bool in_order = true;
+            fc::reflector<T>::visit( memcpy_offset_visitor<T>{ obj, next, in_order } );
+            return in_order;
+          }();
+          return in_order;
+        } else {
+          return true;
+        }
+      }
+
       template<typename Stream, typename Class>
       struct pack_object_visitor {
         pack_object_visitor(const Class& _c, Stream& _s)
@@ -394,10 +570,22 @@ namespace fc {
       struct if_enum {
         template<typename Stream, typename T>
         static inline void pack( Stream& s, const T& v ) {
+          if constexpr( is_memcpy_packable<T>() ) {
+            if( has_memcpy_layout<T>() ) {
+              s.write( (const char*)&v, sizeof(v) );
+              return;
+            }
+          }
           fc::reflector<T>::visit( pack_object_visitor<Stream,T>( v, s ) );
         }
         template<typename Stream, typename T>
         static inline void unpack( Stream& s, T& v ) {
+          if constexpr( is_memcpy_packable<T>() ) {
+            if( has_memcpy_layout<T>() ) {
+              s.read( (char*)&v, sizeof(v) );
+              return;
+            }
+          }
           fc::reflector<T>::visit( unpack_object_visitor<Stream,T>( v, s ) );
         }
       };
@@ -560,6 +748,13 @@ namespace fc {
     inline void pack( Stream& s, const std::vector<T>& value ) {
       FC_ASSERT( value.size() <= MAX_NUM_ARRAY_ELEMENTS );
       fc::raw::pack( s, unsigned_int((uint32_t)value.size()) );
+      if constexpr( detail::is_memcpy_packable<T>() ) {
+        if( detail::has_memcpy_layout<T>() ) {
+          if( value.size() )
+            s.write( (const char*)value.data(), value.size() * sizeof(T) );
+          return;
+        }
+      }
       auto itr = value.begin();
       auto end = value.end();
       while( itr != end ) {
@@ -572,6 +767,15 @@ namespace fc {
     inline void unpack( Stream& s, std::vector<T>& value ) {
       unsigned_int size; fc::raw::unpack( s, size );
       FC_ASSERT( size.value <= MAX_NUM_ARRAY_ELEMENTS );
+      if constexpr( detail::is_memcpy_packable<T>() ) {
+        if( detail::has_memcpy_layout<T>() ) {
+          detail::check_remaining( s, size_t(size.value) * sizeof(T) );
+          value.resize(size.value);
+          if( value.size() )
+            s.read( (char*)value.data(), value.size() * sizeof(T) );
+          return;
+        }
+      }
       value.resize(size.value);
       auto itr = value.begin();
       auto end = value.end();
@@ -651,30 +855,57 @@ namespace fc {
       return ps.tellp();
     }
 
+    namespace detail {
+      /// larger packing buffers are released after use instead of being kept by the thread
+      constexpr size_t max_retained_pack_buffer_size = 4*1024*1024;
+
+      /**
+       * Packs args in one pass into a buffer kept by the calling thread and passes the packed bytes to consume.
+       * Nested calls, e.g. from a pack overload that packs a member separately, use a buffer of their own.
+       */
+      template<typename Consume, typename... Args>
+      inline auto with_packed( Consume&& consume, const Args&... args ) {
+        thread_local std::vector<char> buffer;
+        thread_local bool in_use = false;
+        if( in_use ) {
+          std::vector<char> nested;
+          datastream<std::vector<char>> ds( nested );
+          fc::raw::pack( ds, args... );
+          return consume( nested.data(), nested.size() );
+        }
+        in_use = true;
+        auto release = fc::make_scoped_exit( [&]() {
+          in_use = false;
+          if( buffer.capacity() > max_retained_pack_buffer_size )
+            std::vector<char>().swap( buffer );
+        } );
+        buffer.clear();
+        datastream<std::vector<char>> ds( buffer );
+        fc::raw::pack( ds, args... );
+        return consume( buffer.data(), buffer.size() );
+      }
+    }
+
     template<typename T>
     inline std::vector<char> pack(  const T& v ) {
-      datastream<size_t> ps;
-      fc::raw::pack(ps,v );
-      std::vector<char> vec(ps.tellp());
-
-      if( vec.size() ) {
-        datastream<char*>  ds( vec.data(), size_t(vec.size()) );
-        fc::raw::pack(ds,v);
-      }
-      return vec;
+      return detail::with_packed( []( const char* d, size_t s ) { return std::vector<char>( d, d + s ); }, v );
     }
 
     template<typename T, typename... Next>
     inline std::vector<char> pack(  const T& v, Next... next ) {
-      datastream<size_t> ps;
-      fc::raw::pack(ps,v,next...);
-      std::vector<char> vec(ps.tellp());
-
-      if( vec.size() ) {
-        datastream<char*>  ds( vec.data(), size_t(vec.size()) );
-        fc::raw::pack(ds,v,next...);
-      }
-      return vec;
+      return detail::with_packed( []( const char* d, size_t s ) { return std::vector<char>( d, d + s ); }, v, next... );
+    }
+
+    /**
+     * Replaces the contents of out with the packed v, walking v once. out is resized once, to the exact size, which
+     * keeps containers in a chainbase segment, like shared_string and shared_blob, from holding spare capacity.
+     */
+    template<typename Container, typename T>
+    inline void pack_into( Container& out, const T& v ) {
+      detail::with_packed( [&]( const char* d, size_t s ) {
+        out.resize( s );
+        if( s ) memcpy( out.data(), d, s );
+      }, v );
     }
 
 
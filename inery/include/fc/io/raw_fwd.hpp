@@ -7,6 +7,7 @@
 #include <deque>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 #include <unordered_map>
 #include <set>
@@ -32,6 +33,12 @@ namespace fc {
     template<typename T>
     inline size_t pack_size(  const T& v );
 
+    /**
+     * Specialize as std::true_type for classes that are not reflected and are packed as their object representation,
+     * like the hash types, so structs containing them can still be packed with a single copy.
+     */
+    template<typename T> struct has_trivial_raw_format : std::false_type {};
+
     template<typename Stream, typename Storage> inline void pack( Stream& s, const fc::fixed_string<Storage>& u );
     template<typename Stream, typename Storage> inline void unpack( Stream& s, fc::fixed_string<Storage>& u );
 
@@ -90,6 +97,8 @@ namespace fc {
     template<typename Stream> void pack( Stream& s, const time_point_sec& );
     template<typename Stream> void unpack( Stream& s, std::string& );
     template<typename Stream> void pack( Stream& s, const std::string& );
+    template<typename Stream> void unpack( Stream& s, std::string_view& );
+    template<typename Stream> void pack( Stream& s, const std::string_view& );
     template<typename Stream> void unpack( Stream& s, fc::ecc::public_key& );
     template<typename Stream> void pack( Stream& s, const fc::ecc::public_key& );
     template<typename Stream> void unpack( Stream& s, fc::ecc::private_key& );
@@ -165,12 +165,12 @@ struct reflector_init_visitor {
 
 #define FC_REFLECT_DERIVED_IMPL_INLINE( TYPE, INHERITS, MEMBERS ) \
 template<typename Visitor>\
-static inline void visit_base( Visitor&& v ) { \
+static constexpr void visit_base( Visitor&& v ) { \
     BOOST_PP_SEQ_FOR_EACH( FC_REFLECT_VISIT_BASE, v, INHERITS ) \
     BOOST_PP_SEQ_FOR_EACH( FC_REFLECT_VISIT_MEMBER, v, MEMBERS ) \
 } \
 template<typename Visitor>\
-static inline void visit( Visitor&& v ) { \
+static constexpr void visit( Visitor&& v ) { \
     BOOST_PP_SEQ_FOR_EACH( FC_REFLECT_VISIT_BASE, v, INHERITS ) \
     BOOST_PP_SEQ_FOR_EACH( FC_REFLECT_VISIT_MEMBER, v, MEMBERS ) \
     init( std::forward<Visitor>(v) ); \
@@ -279,9 +279,9 @@ template<BOOST_PP_SEQ_ENUM(TEMPLATE_ARGS)> struct reflector<TYPE> {\
        std::forward<Visitor>(v).reflector_init(); \
     } \
     template<typename Visitor> \
-    static auto init_imp(Visitor&& v, long) -> decltype(v, void()) {} \
+    static constexpr auto init_imp(Visitor&& v, long) -> decltype(v, void()) {} \
     template<typename Visitor> \
-    static auto init(Visitor&& v) -> decltype(init_imp(std::forward<Visitor>(v), 0), void()) { \
+    static constexpr auto init(Visitor&& v) -> decltype(init_imp(std::forward<Visitor>(v), 0), void()) { \
        init_imp(std::forward<Visitor>(v), 0); \
     } \
     enum  member_count_enum {  \
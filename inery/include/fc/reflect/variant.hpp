@@ -64,6 +64,8 @@ namespace fc
      static inline void to_variant( const T& v, fc::variant& vo ) 
      { 
          mutable_variant_object mvo;
+         // absent optionals are skipped, so this is an upper bound; it saves regrowing the entries while visiting
+         mvo.reserve( fc::reflector<T>::total_member_count );
          fc::reflector<T>::visit( to_variant_visitor<T>( mvo, v ) );
          vo = fc::move(mvo);
      }
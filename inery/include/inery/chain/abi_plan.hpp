@@ -0,0 +1,321 @@
+#pragma once
+
+#include <inery/chain/abi_serializer.hpp>
+#include <inery/chain/exceptions.hpp>
+
+#include <map>
+#include <memory>
+#include <optional>
+
+namespace inery { namespace chain {
+
+/**
+ * An abi_serializer compiled into an index based execution plan.
+ *
+ * Every type reachable from the ABI is resolved once into a node: typedefs are followed, arrays, optionals and
+ * variants refer to the node of their element, and structs refer to their base and hold their fields with the JSON
+ * key already escaped. The common built-in types are decoded inline, strings and bytes without copying them out of
+ * the input; other built-ins call their unpack_function without looking it up by name. binary_to_json() produces the same text as abi_serializer::binary_to_json().
+ *
+ * Errors are not reported by the plan itself: when decoding fails, the input is decoded again by the serializer,
+ * which raises the exception, with its path, that the serializer always raised. Structs whose base repeats a field
+ * name are left to the serializer in the same way. Running out of time is not retried.
+ *
+ * Set native_builtins to false if built-in types were replaced with add_specialized_unpack_pack().
+ */
+class abi_plan {
+   public:
+      using yield_function_t = abi_serializer::yield_function_t;
+
+      explicit abi_plan( std::shared_ptr<const abi_serializer> abis, bool native_builtins = true )
+      : _abis( std::move( abis ) ), _native_builtins( native_builtins ) {
+         for( const auto& s : _abis->structs )
+            compile_struct( s.first );
+         for( const auto& a : _abis->actions )
+            node_of( a.second );
+         for( const auto& t : _abis->tables )
+            node_of( t.second );
+      }
+
+      abi_plan( const abi_plan& ) = delete;
+      abi_plan& operator=( const abi_plan& ) = delete;
+
+      const abi_serializer& serializer()const { return *_abis; }
+
+      void binary_to_json( const std::string_view& type, const bytes& binary, std::string& out, const yield_function_t& yield,
+                           const fc::json::yield_function_t& output_yield, bool short_path = false,
+                           fc::json::output_formatting format = fc::json::output_formatting::stringify_large_ints_and_doubles )const {
+         fc::datastream<const char*> ds( binary.data(), binary.size() );
+         binary_to_json( type, ds, out, yield, output_yield, short_path, format );
+      }
+
+      void binary_to_json( const std::string_view& type, fc::datastream<const char*>& binary, std::string& out, const yield_function_t& yield,
+                           const fc::json::yield_function_t& output_yield, bool short_path = false,
+                           fc::json::output_formatting format = fc::json::output_formatting::stringify_large_ints_and_doubles )const {
+         const size_t start_pos = binary.tellp();
+         const size_t start_size = out.size();
+         auto itr = _types.find( type );
+         if( itr != _types.end() ) {
+            try {
+               run_context ctx{ binary, out, start_size, yield, output_yield, format };
+               write_value( itr->second, 1, ctx );
+               return;
+            } catch( const abi_serialization_deadline_exception& ) {
+               throw;
+            } catch( const fc::timeout_exception& ) {
+               throw;
+            } catch( ... ) {
+               binary.seekp( start_pos );
+               out.resize( start_size );
+            }
+         }
+         _abis->binary_to_json( type, binary, out, yield, output_yield, short_path, format );
+      }
+
+   private:
+      enum class op : uint8_t { builtin, native, array, optional, variant, struct_type, delegate };
+      enum class native_type : uint8_t { bool_type, int8, uint8, int16, uint16, int32, uint32, int64, uint64, varint32, varuint32, name_type, string_type, bytes_type };
+
+      struct node {
+         op       kind  = op::delegate;
+         uint32_t index = 0; ///< of the builtin, element node, variant, struct or native_type
+      };
+      struct builtin {
+         const abi_serializer::unpack_function* unpack;
+         bool                                   is_array;
+         bool                                   is_optional;
+      };
+      struct field {
+         std::string key;       ///< "\"name\":"
+         uint32_t    type;
+         bool        extension;
+      };
+      struct struct_plan {
+         int64_t            base = -1; ///< struct index
+         std::vector<field> fields;
+      };
+      struct variant_plan {
+         std::vector<std::pair<std::string, uint32_t>> alternatives; ///< "[\"type\"," and its node
+      };
+      struct run_context {
+         fc::datastream<const char*>&      stream;
+         std::string&                      out;
+         const size_t                      begin;
+         const yield_function_t&           yield;
+         const fc::json::yield_function_t& output_yield;
+         fc::json::output_formatting       format;
+      };
+
+      /// node of type as written in the ABI, following abi_serializer::_binary_to_json
+      uint32_t node_of( const std::string_view& type ) {
+         auto itr = _types.find( type );
+         if( itr != _types.end() )
+            return itr->second;
+         const uint32_t n = _nodes.size();
+         _nodes.emplace_back();
+         _types.emplace( std::string( type ), n );
+
+         node result;
+         auto rtype = _abis->resolve_type( type );
+         auto ftype = _abis->fundamental_type( rtype );
+         auto btype = _abis->built_in_types.find( ftype );
+         if( btype != _abis->built_in_types.end() ) {
+            auto native = native_type_of( ftype );
+            if( native && !_abis->is_array( rtype ) && !_abis->is_optional( rtype ) ) {
+               result = { op::native, static_cast<uint32_t>( *native ) };
+            } else {
+               result = { op::builtin, static_cast<uint32_t>( _builtins.size() ) };
+               _builtins.push_back( { &btype->second.first, _abis->is_array( rtype ), _abis->is_optional( rtype ) } );
+            }
+         } else if( _abis->is_array( rtype ) ) {
+            result = { op::array, node_of( ftype ) };
+         } else if( _abis->is_optional( rtype ) ) {
+            result = { op::optional, node_of( ftype ) };
+         } else if( auto v_itr = _abis->variants.find( rtype ); v_itr != _abis->variants.end() ) {
+            variant_plan vp;
+            for( const auto& t : v_itr->second.types ) {
+               std::string prefix = "[";
+               impl::write_json_string( prefix, t );
+               prefix += ',';
+               vp.alternatives.emplace_back( std::move( prefix ), 0 );
+            }
+            result = { op::variant, static_cast<uint32_t>( _variants.size() ) };
+            _variants.push_back( std::move( vp ) );
+            for( size_t i = 0; i < v_itr->second.types.size(); ++i ) {
+               const uint32_t alt = node_of( v_itr->second.types[i] );
+               _variants[result.index].alternatives[i].second = alt;
+            }
+         } else if( auto s = compile_struct( rtype ) ) {
+            result = { op::struct_type, *s };
+         }
+         _nodes[n] = result;
+         return n;
+      }
+
+      /// @return the index of struct type, or nothing if it is unknown or cannot be streamed
+      std::optional<uint32_t> compile_struct( const std::string_view& type ) {
+         auto itr = _struct_index.find( type );
+         if( itr != _struct_index.end() )
+            return itr->second;
+         auto s_itr = _abis->structs.find( type );
+         if( s_itr == _abis->structs.end() || _abis->_has_duplicate_fields( s_itr->second ) )
+            return {};
+         const uint32_t index = _structs.size();
+         _structs.emplace_back();
+         _struct_index.emplace( std::string( type ), index );
+
+         const struct_def& st = s_itr->second;
+         int64_t base = -1;
+         if( st.base != type_name() ) {
+            auto b = compile_struct( _abis->resolve_type( st.base ) );
+            if( !b ) {
+               _struct_index[std::string( type )] = {};
+               return {};
+            }
+            base = *b;
+         }
+         std::vector<field> fields;
+         for( const auto& f : st.fields ) {
+            const bool extension = f.type.size() && f.type.back() == '$';
+            std::string key;
+            impl::write_json_string( key, f.name );
+            key += ':';
+            fields.push_back( { std::move( key ), node_of( extension ? abi_serializer::_remove_bin_extension( f.type ) : std::string_view( f.type ) ), extension } );
+         }
+         _structs[index].base = base;
+         _structs[index].fields = std::move( fields );
+         return index;
+      }
+
+      std::optional<native_type> native_type_of( const std::string_view& t )const {
+         if( !_native_builtins ) return {};
+         static const std::map<std::string_view, native_type> native_types = {
+            { "bool", native_type::bool_type }, { "int8", native_type::int8 }, { "uint8", native_type::uint8 },
+            { "int16", native_type::int16 }, { "uint16", native_type::uint16 }, { "int32", native_type::int32 },
+            { "uint32", native_type::uint32 }, { "int64", native_type::int64 }, { "uint64", native_type::uint64 },
+            { "varint32", native_type::varint32 }, { "varuint32", native_type::varuint32 },
+            { "name", native_type::name_type }, { "string", native_type::string_type }, { "bytes", native_type::bytes_type }
+         };
+         auto itr = native_types.find( t );
+         if( itr == native_types.end() ) return {};
+         return itr->second;
+      }
+
+      template<typename T>
+      static void write_native( run_context& ctx ) {
+         T v;
+         fc::raw::unpack( ctx.stream, v );
+         impl::write_json( ctx.out, fc::variant( v ), ctx.format, ctx.output_yield, ctx.begin );
+      }
+
+      // depth matches the recursion depth abi_traverse_context passes to yield
+      bool write_value( uint32_t n, size_t depth, run_context& ctx )const {
+         ctx.yield( depth );
+         const node& nd = _nodes[n];
+         ctx.output_yield( ctx.out.size() - ctx.begin );
+         switch( nd.kind ) {
+            case op::native:
+               switch( static_cast<native_type>( nd.index ) ) {
+                  case native_type::bool_type:   write_native<bool>( ctx ); break;
+                  case native_type::int8:        write_native<int8_t>( ctx ); break;
+                  case native_type::uint8:       write_native<uint8_t>( ctx ); break;
+                  case native_type::int16:       write_native<int16_t>( ctx ); break;
+                  case native_type::uint16:      write_native<uint16_t>( ctx ); break;
+                  case native_type::int32:       write_native<int32_t>( ctx ); break;
+                  case native_type::uint32:      write_native<uint32_t>( ctx ); break;
+                  case native_type::int64:       write_native<int64_t>( ctx ); break;
+                  case native_type::uint64:      write_native<uint64_t>( ctx ); break;
+                  case native_type::varint32:    write_native<fc::signed_int>( ctx ); break;
+                  case native_type::varuint32:   write_native<fc::unsigned_int>( ctx ); break;
+                  case native_type::name_type:   write_native<name>( ctx ); break;
+                  case native_type::string_type: {
+                     std::string_view str;
+                     fc::raw::unpack( ctx.stream, str );
+                     impl::write_json_string( ctx.out, str );
+                     break;
+                  }
+                  case native_type::bytes_type: {
+                     std::string_view data;
+                     fc::raw::unpack( ctx.stream, data );
+                     ctx.out += '"';
+                     ctx.out += fc::to_hex( data.data(), data.size() );
+                     ctx.out += '"';
+                     break;
+                  }
+               }
+               return true;
+            case op::builtin: {
+               const builtin& b = _builtins[nd.index];
+               fc::variant v = ( *b.unpack )( ctx.stream, b.is_array, b.is_optional, ctx.yield );
+               impl::write_json( ctx.out, v, ctx.format, ctx.output_yield, ctx.begin );
+               return !v.is_null();
+            }
+            case op::array: {
+               fc::unsigned_int size;
+               fc::raw::unpack( ctx.stream, size );
+               ctx.out += '[';
+               for( uint32_t i = 0; i < size.value; ++i ) {
+                  if( i ) ctx.out += ',';
+                  FC_ASSERT( write_value( nd.index, depth + 1, ctx ) );
+               }
+               ctx.out += ']';
+               return true;
+            }
+            case op::optional: {
+               char flag;
+               fc::raw::unpack( ctx.stream, flag );
+               if( flag )
+                  return write_value( nd.index, depth + 1, ctx );
+               ctx.out += "null";
+               return false;
+            }
+            case op::variant: {
+               const variant_plan& vp = _variants[nd.index];
+               fc::unsigned_int select;
+               fc::raw::unpack( ctx.stream, select );
+               FC_ASSERT( select.value < vp.alternatives.size() );
+               ctx.out += vp.alternatives[select.value].first;
+               write_value( vp.alternatives[select.value].second, depth + 1, ctx );
+               ctx.out += ']';
+               return true;
+            }
+            case op::struct_type: {
+               size_t fields = 0;
+               ctx.out += '{';
+               write_fields( _structs[nd.index], depth + 1, fields, ctx );
+               FC_ASSERT( fields > 0 );
+               ctx.out += '}';
+               return true;
+            }
+            case op::delegate:
+               break;
+         }
+         FC_THROW( "type is decoded by the serializer" );
+      }
+
+      void write_fields( const struct_plan& sp, size_t depth, size_t& fields, run_context& ctx )const {
+         ctx.yield( depth );
+         if( sp.base >= 0 )
+            write_fields( _structs[sp.base], depth + 1, fields, ctx );
+         for( const field& f : sp.fields ) {
+            if( !ctx.stream.remaining() ) {
+               FC_ASSERT( f.extension );
+               continue;
+            }
+            if( fields++ ) ctx.out += ',';
+            ctx.out += f.key;
+            write_value( f.type, depth + 1, ctx );
+         }
+      }
+
+      std::shared_ptr<const abi_serializer>                 _abis;
+      const bool                                            _native_builtins;
+      std::vector<node>                                     _nodes;
+      std::vector<builtin>                                  _builtins;
+      std::vector<variant_plan>                             _variants;
+      std::vector<struct_plan>                              _structs;
+      std::map<std::string, uint32_t, std::less<>>          _types;        ///< type as written in the ABI -> node
+      std::map<std::string, std::optional<uint32_t>, std::less<>> _struct_index; ///< resolved struct name -> struct
+};
+
+} } // inery::chain
@@ -5,6 +5,7 @@
 #include <utility>
 #include <fc/variant_object.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/json.hpp>
 
 namespace inery { namespace chain {
 
@@ -21,9 +22,12 @@ namespace impl {
    struct abi_traverse_context;
    struct abi_traverse_context_with_path;
    struct binary_to_variant_context;
+   struct binary_to_json_context;
    struct variant_to_binary_context;
 }
 
+class abi_plan;
+
 /**
  *  Describes the binary representation message and table contents so that it can
  *  be converted to and from JSON.
@@ -77,6 +81,20 @@ struct abi_serializer {
    void        variant_to_binary( const std::string_view& type, const fc::variant& var, fc::datastream<char*>& ds, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    void        variant_to_binary( const std::string_view& type, const fc::variant& var, fc::datastream<char*>& ds, const yield_function_t& yield, bool short_path = false )const;
 
+   /**
+    * Appends the JSON of binary unpacked as type to out. The text is the same as that of
+    * fc::json::to_string( binary_to_variant( type, binary, yield, short_path ), output_yield, format ), but objects and
+    * arrays are written as they are unpacked instead of being built as variants first. output_yield is passed the size of
+    * the JSON written so far before each value, as fc::json::to_string does. Reuse out across calls to avoid
+    * reallocating it; on exception its contents are unspecified.
+    */
+   void binary_to_json( const std::string_view& type, const bytes& binary, std::string& out, const yield_function_t& yield,
+                        const fc::json::yield_function_t& output_yield, bool short_path = false,
+                        fc::json::output_formatting format = fc::json::output_formatting::stringify_large_ints_and_doubles )const;
+   void binary_to_json( const std::string_view& type, fc::datastream<const char*>& binary, std::string& out, const yield_function_t& yield,
+                        const fc::json::yield_function_t& output_yield, bool short_path = false,
+                        fc::json::output_formatting format = fc::json::output_formatting::stringify_large_ints_and_doubles )const;
+
    template<typename T, typename Resolver>
    static void to_variant( const T& o, fc::variant& vo, Resolver resolver, const yield_function_t& yield );
    template<typename T, typename Resolver>
@@ -148,6 +166,12 @@ private:
    void        _binary_to_variant( const std::string_view& type, fc::datastream<const char*>& stream,
                                    fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const;
 
+   /// @return false if null was written, i.e. for an absent optional
+   bool        _binary_to_json( const std::string_view& type, fc::datastream<const char*>& stream, impl::binary_to_json_context& ctx )const;
+   /// writes the fields of struct type, including those of its bases, separated by commas
+   void        _binary_to_json( const std::string_view& type, fc::datastream<const char*>& stream, size_t& fields, impl::binary_to_json_context& ctx )const;
+   bool        _has_duplicate_fields( const struct_def& st )const;
+
    bytes       _variant_to_binary( const std::string_view& type, const fc::variant& var, impl::variant_to_binary_context& ctx )const;
    void        _variant_to_binary( const std::string_view& type, const fc::variant& var,
                                    fc::datastream<char*>& ds, impl::variant_to_binary_context& ctx )const;
@@ -160,6 +184,8 @@ private:
    friend struct impl::abi_from_variant;
    friend struct impl::abi_to_variant;
    friend struct impl::abi_traverse_context_with_path;
+   friend struct impl::binary_to_json_context;
+   friend class abi_plan;
 };
 
 namespace impl {
@@ -253,6 +279,32 @@ namespace impl {
       using abi_traverse_context_with_path::abi_traverse_context_with_path;
    };
 
+   struct binary_to_json_context : public binary_to_variant_context {
+      binary_to_json_context( const abi_serializer& abis, abi_serializer::yield_function_t yield, const std::string_view& type,
+                              std::string& out, const fc::json::yield_function_t& output_yield, fc::json::output_formatting format )
+      : binary_to_variant_context( abis, std::move( yield ), type ), out( out ), begin( out.size() ), output_yield( output_yield ), format( format )
+      {}
+
+      /// calls output_yield with the size of the JSON written so far
+      void check_output_size()const { output_yield( out.size() - begin ); }
+
+      /// abis._has_duplicate_fields( st ), worked out once per struct for the whole conversion
+      bool has_duplicate_fields( const struct_def& st ) {
+         if( st.base == type_name() )
+            return false;
+         auto itr = duplicate_fields.find( &st );
+         if( itr == duplicate_fields.end() )
+            itr = duplicate_fields.emplace( &st, abis._has_duplicate_fields( st ) ).first;
+         return itr->second;
+      }
+
+      std::string&                     out;
+      const size_t                     begin;
+      const fc::json::yield_function_t& output_yield;
+      fc::json::output_formatting      format;
+      std::map<const struct_def*, bool> duplicate_fields;
+   };
+
    struct variant_to_binary_context : public abi_traverse_context_with_path {
       using abi_traverse_context_with_path::abi_traverse_context_with_path;
 
@@ -267,6 +319,96 @@ namespace impl {
    /// limits the string size to default max_length of output_name
    string limit_size( const std::string_view& str );
 
+   inline void write_json_string( std::string& out, const std::string_view& str ) {
+      out += '"';
+      // field and type names almost never need escaping
+      if( std::all_of( str.begin(), str.end(), []( char c ) { return c >= 0x20 && c < 0x7f && c != '"' && c != '\\'; } ) )
+         out += str;
+      else
+         out += fc::escape_string( str, fc::json::yield_function_t() );
+      out += '"';
+   }
+
+   /**
+    * Appends v to out following the rules of fc::json::to_string. Before each value, yield is passed the size of the
+    * JSON written since begin, which is where the output of the to_string call being reproduced starts.
+    */
+   inline void write_json( std::string& out, const fc::variant& v, fc::json::output_formatting format,
+                           const fc::json::yield_function_t& yield, size_t begin ) {
+      yield( out.size() - begin );
+      const bool stringify = format == fc::json::output_formatting::stringify_large_ints_and_doubles;
+      switch( v.get_type() ) {
+         case fc::variant::null_type:
+            out += "null";
+            return;
+         case fc::variant::int64_type: {
+            const int64_t i = v.as_int64();
+            if( stringify && ( i > 0xffffffff || i < -int64_t( 0xffffffff ) ) ) {
+               out += '"';
+               out += std::to_string( i );
+               out += '"';
+            } else {
+               out += std::to_string( i );
+            }
+            return;
+         }
+         case fc::variant::uint64_type: {
+            const uint64_t u = v.as_uint64();
+            if( stringify && u > 0xffffffff ) {
+               out += '"';
+               out += std::to_string( u );
+               out += '"';
+            } else {
+               out += std::to_string( u );
+            }
+            return;
+         }
+         case fc::variant::double_type:
+            if( stringify ) {
+               out += '"';
+               out += v.as_string();
+               out += '"';
+            } else {
+               out += v.as_string();
+            }
+            return;
+         case fc::variant::bool_type:
+            out += v.as_bool() ? "true" : "false";
+            return;
+         case fc::variant::string_type:
+            write_json_string( out, v.get_string() );
+            return;
+         case fc::variant::blob_type:
+            write_json_string( out, v.as_string() );
+            return;
+         case fc::variant::array_type: {
+            out += '[';
+            bool first = true;
+            for( const auto& e : v.get_array() ) {
+               if( !first ) out += ',';
+               first = false;
+               write_json( out, e, format, yield, begin );
+            }
+            out += ']';
+            return;
+         }
+         case fc::variant::object_type: {
+            out += '{';
+            bool first = true;
+            for( const auto& e : v.get_object() ) {
+               if( !first ) out += ',';
+               first = false;
+               write_json_string( out, e.key() );
+               out += ':';
+               write_json( out, e.value(), format, yield, begin );
+            }
+            out += '}';
+            return;
+         }
+      }
+      FC_THROW_EXCEPTION( fc::invalid_arg_exception, "Unsupported variant type: ${t}", ("t", static_cast<int>( v.get_type() )) );
+   }
+
    /**
     * Determine if a type contains ABI related info, perhaps deeply nested
     * @tparam T - the type to check
@@ -413,13 +555,14 @@ namespace impl {
          static_assert(fc::reflector<action>::total_member_count == 4);
          auto h = ctx.enter_scope();
          mutable_variant_object mvo;
+         mvo.reserve(fc::reflector<action>::total_member_count + 1); // hex_data
          mvo("account", act.account);
          mvo("name", act.name);
          mvo("authorization", act.authorization);
 
          try {
             auto abi = resolver(act.account);
-            if (abi.valid()) {
+            if (abi) {
                auto type = abi->get_action_type(act.name);
                if (!type.empty()) {
                   try {
@@ -458,6 +601,7 @@ namespace impl {
          static_assert(fc::reflector<packed_transaction>::total_member_count == 4);
          auto h = ctx.enter_scope();
          mutable_variant_object mvo;
+         mvo.reserve(fc::reflector<packed_transaction>::total_member_count + 3); // id, context_free_data, transaction
          auto trx = ptrx.get_transaction();
          mvo("id", trx.id());
          mvo("signatures", ptrx.get_signatures());
@@ -481,6 +625,7 @@ namespace impl {
          static_assert(fc::reflector<transaction>::total_member_count == 9);
          auto h = ctx.enter_scope();
          mutable_variant_object mvo;
+         mvo.reserve(fc::reflector<transaction>::total_member_count); // deferred_transaction_generation instead of transaction_extensions
          mvo("expiration", trx.expiration);
          mvo("ref_block_num", trx.ref_block_num);
          mvo("ref_block_prefix", trx.ref_block_prefix);
@@ -512,6 +657,7 @@ namespace impl {
          static_assert(fc::reflector<signed_block>::total_member_count == 12);
          auto h = ctx.enter_scope();
          mutable_variant_object mvo;
+         mvo.reserve(fc::reflector<signed_block>::total_member_count + 1); // three extension keys instead of header_extensions and block_extensions
          mvo("timestamp", block.timestamp);
          mvo("master", block.master);
          mvo("confirmed", block.confirmed);
@@ -669,7 +815,7 @@ namespace impl {
                valid_empty_data = act.data.empty();
             } else if ( data.is_object() ) {
                auto abi = resolver(act.account);
-               if (abi.valid()) {
+               if (abi) {
                   auto type = abi->get_action_type(act.name);
                   if (!type.empty()) {
                      variant_to_binary_context _ctx(*abi, ctx, type);
@@ -785,6 +931,7 @@ namespace impl {
    {
       auto h = ctx.enter_scope();
       mutable_variant_object member_mvo;
+      member_mvo.reserve( fc::reflector<M>::total_member_count );
       fc::reflector<M>::visit( impl::abi_to_variant_visitor<M, Resolver>( member_mvo, v, resolver, ctx) );
       mvo(name, std::move(member_mvo));
    }
@@ -822,5 +969,150 @@ void abi_serializer::from_variant( const variant& v, T& o, Resolver resolver, co
    from_variant( v, o, resolver, create_yield_function(max_serialization_time) );
 }
 
+inline void abi_serializer::binary_to_json( const std::string_view& type, const bytes& binary, std::string& out, const yield_function_t& yield,
+                                            const fc::json::yield_function_t& output_yield, bool short_path, fc::json::output_formatting format )const {
+   fc::datastream<const char*> ds( binary.data(), binary.size() );
+   binary_to_json( type, ds, out, yield, output_yield, short_path, format );
+}
+
+inline void abi_serializer::binary_to_json( const std::string_view& type, fc::datastream<const char*>& binary, std::string& out, const yield_function_t& yield,
+                                            const fc::json::yield_function_t& output_yield, bool short_path, fc::json::output_formatting format )const {
+   impl::binary_to_json_context ctx( *this, yield, type, out, output_yield, format );
+   ctx.short_path = short_path;
+   _binary_to_json( type, binary, ctx );
+}
+
+// Mirrors _binary_to_variant, including its error messages.
+inline bool abi_serializer::_binary_to_json( const std::string_view& type, fc::datastream<const char*>& stream, impl::binary_to_json_context& ctx )const
+{
+   auto h = ctx.enter_scope();
+   auto rtype = resolve_type(type);
+   auto ftype = fundamental_type(rtype);
+   auto btype = built_in_types.find(ftype );
+   if( btype != built_in_types.end() ) {
+      // write_json yields for the value itself
+      fc::variant v;
+      try {
+         v = btype->second.first(stream, is_array(rtype), is_optional(rtype), ctx.get_yield_function());
+      } INE_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                ("class", is_array(rtype) ? "array of built-in" : is_optional(rtype) ? "optional of built-in" : "built-in")
+                                ("type", impl::limit_size(ftype))("p", ctx.get_path_string()) )
+      impl::write_json( ctx.out, v, ctx.format, ctx.output_yield, ctx.begin );
+      return !v.is_null();
+   }
+   ctx.check_output_size();
+   if ( is_array(rtype) ) {
+      ctx.hint_array_type_if_in_array();
+      fc::unsigned_int size;
+      try {
+         fc::raw::unpack(stream, size);
+      } INE_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+      ctx.out += '[';
+      auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+      for( decltype(size.value) i = 0; i < size; ++i ) {
+         ctx.set_array_index_of_path_back(i);
+         if( i ) ctx.out += ',';
+         INE_ASSERT( _binary_to_json(ftype, stream, ctx), unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+      }
+      ctx.out += ']';
+      return true;
+   } else if ( is_optional(rtype) ) {
+      char flag;
+      try {
+         fc::raw::unpack(stream, flag);
+      } INE_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+      if( flag )
+         return _binary_to_json(ftype, stream, ctx);
+      ctx.out += "null";
+      return false;
+   } else {
+      auto v_itr = variants.find(rtype);
+      if( v_itr != variants.end() ) {
+         ctx.hint_variant_type_if_in_array( v_itr );
+         fc::unsigned_int select;
+         try {
+            fc::raw::unpack(stream, select);
+         } INE_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+         INE_ASSERT( (size_t)select < v_itr->second.types.size(), unpack_exception,
+                     "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p",ctx.get_path_string()) );
+         auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = v_itr, .variant_ordinal = static_cast<uint32_t>(select) } );
+         ctx.out += '[';
+         impl::write_json_string( ctx.out, v_itr->second.types[select] );
+         ctx.out += ',';
+         _binary_to_json(v_itr->second.types[select], stream, ctx);
+         ctx.out += ']';
+         return true;
+      }
+   }
+
+   auto s_itr = structs.find(rtype);
+   if( s_itr != structs.end() && ctx.has_duplicate_fields( s_itr->second ) ) {
+      // a field of a derived struct replaces the base field of the same name in place, which cannot be streamed
+      fc::mutable_variant_object mvo;
+      _binary_to_variant(rtype, stream, mvo, ctx);
+      INE_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+      impl::write_json( ctx.out, fc::variant( std::move(mvo) ), ctx.format, ctx.output_yield, ctx.begin );
+      return true;
+   }
+   size_t fields = 0;
+   ctx.out += '{';
+   _binary_to_json(rtype, stream, fields, ctx);
+   INE_ASSERT( fields > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+   ctx.out += '}';
+   return true;
+}
+
+inline void abi_serializer::_binary_to_json( const std::string_view& type, fc::datastream<const char*>& stream,
+                                             size_t& fields, impl::binary_to_json_context& ctx )const
+{
+   auto h = ctx.enter_scope();
+   auto s_itr = structs.find(type);
+   INE_ASSERT( s_itr != structs.end(), invalid_type_inside_abi, "Unknown type ${type}", ("type",ctx.maybe_shorten(type)) );
+   ctx.hint_struct_type_if_in_array( s_itr );
+   const auto& st = s_itr->second;
+   if( st.base != type_name() ) {
+      _binary_to_json(resolve_type(st.base), stream, fields, ctx);
+   }
+   bool encountered_extension = false;
+   for( uint32_t i = 0; i < st.fields.size(); ++i ) {
+      const auto& field = st.fields[i];
+      bool extension = field.type.size() && field.type.back() == '$';
+      encountered_extension |= extension;
+      if( !stream.remaining() ) {
+         if( extension ) {
+            continue;
+         }
+         if( encountered_extension ) {
+            INE_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                       ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+         }
+         INE_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                    ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+      }
+      auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = s_itr, .field_ordinal = i } );
+      auto field_type = resolve_type( extension ? _remove_bin_extension(field.type) : field.type );
+      if( fields++ ) ctx.out += ',';
+      impl::write_json_string( ctx.out, field.name );
+      ctx.out += ':';
+      _binary_to_json(field_type, stream, ctx);
+   }
+}
+
+inline bool abi_serializer::_has_duplicate_fields( const struct_def& st )const {
+   if( st.base == type_name() )
+      return false;
+   std::vector<std::string_view> names;
+   for( const struct_def* s = &st; s; ) {
+      for( const auto& f : s->fields )
+         names.emplace_back( f.name );
+      if( s->base == type_name() )
+         break;
+      auto itr = structs.find( resolve_type( s->base ) );
+      s = itr != structs.end() ? &itr->second : nullptr;
+   }
+   std::sort( names.begin(), names.end() );
+   return std::adjacent_find( names.begin(), names.end() ) != names.end();
+}
+
 
 } } // inery::chain
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <inery/chain/abi_plan.hpp>
+#include <inery/chain/chain_id_type.hpp>
+#include <inery/chain/config.hpp>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace inery { namespace chain {
+
+/**
+ * Deserialized contract ABIs and their compiled plans, shared by everything that converts actions, traces and table
+ * rows to JSON.
+ *
+ * Entries are keyed by chain id, account and the abi_sequence of the setabi that installed the ABI, so a setabi never
+ * leaves a stale entry behind. A speculative setabi that was rolled back may have used the same abi_sequence, so the
+ * packed ABI of an entry is kept and compared byte for byte on every hit; that is a memcmp, far cheaper than hashing
+ * or deserializing the ABI. Thread safe. The least recently used entries beyond max_entries are dropped.
+ */
+class abi_serializer_cache {
+   public:
+      using abi_serializer_ptr = std::shared_ptr<const abi_serializer>;
+      using abi_plan_ptr       = std::shared_ptr<const abi_plan>;
+
+      explicit abi_serializer_cache( size_t max_entries = config::default_abi_serializer_cache_size )
+      : _max_entries( max_entries ) {}
+
+      abi_serializer_cache( const abi_serializer_cache& ) = delete;
+      abi_serializer_cache& operator=( const abi_serializer_cache& ) = delete;
+
+      /// the cache of this process
+      static abi_serializer_cache& instance() {
+         static abi_serializer_cache cache;
+         return cache;
+      }
+
+      /**
+       * @return the serializer of packed_abi, the ABI installed on account by its abi_sequence-th setabi, or null when
+       * account has no ABI. Throws if packed_abi is invalid; failures are not cached.
+       */
+      abi_serializer_ptr get( const chain_id_type& chain_id, account_name account, uint64_t abi_sequence,
+                              const std::string_view& packed_abi, const abi_serializer::yield_function_t& yield ) {
+         return lookup( key_type( chain_id, account, abi_sequence ), packed_abi, yield, false ).serializer;
+      }
+
+      /// @return the plan of the serializer get() returns, compiled on first use
+      abi_plan_ptr get_plan( const chain_id_type& chain_id, account_name account, uint64_t abi_sequence,
+                             const std::string_view& packed_abi, const abi_serializer::yield_function_t& yield ) {
+         return lookup( key_type( chain_id, account, abi_sequence ), packed_abi, yield, true ).plan;
+      }
+
+      void clear() {
+         std::lock_guard<std::mutex> g( _mtx );
+         _entries.clear();
+         _lru.clear();
+      }
+
+      size_t size()const {
+         std::lock_guard<std::mutex> g( _mtx );
+         return _entries.size();
+      }
+
+   private:
+      using key_type = std::tuple<chain_id_type, account_name, uint64_t>;
+
+      struct result {
+         abi_serializer_ptr             serializer;
+         abi_plan_ptr                   plan;
+      };
+
+      struct entry : result {
+         std::string                    packed_abi;
+         std::list<key_type>::iterator  lru;
+      };
+
+      /// @return the serializer and, if with_plan, the plan of packed_abi; both null when account has no ABI
+      result lookup( const key_type& key, const std::string_view& packed_abi, const abi_serializer::yield_function_t& yield, bool with_plan ) {
+         result found;
+         {
+            std::lock_guard<std::mutex> g( _mtx );
+            auto itr = _entries.find( key );
+            if( itr != _entries.end() && itr->second.packed_abi == packed_abi ) {
+               _lru.splice( _lru.begin(), _lru, itr->second.lru );
+               found = itr->second;
+               if( found.plan || !with_plan )
+                  return found;
+            }
+         }
+
+         // built without holding the lock; a concurrent miss on the same key builds an equal serializer
+         if( !found.serializer ) {
+            abi_def abi;
+            if( !abi_serializer::to_abi( packed_abi, abi ) )
+               return {};
+            found.serializer = std::make_shared<const abi_serializer>( abi, yield );
+         }
+         if( with_plan )
+            found.plan = std::make_shared<const abi_plan>( found.serializer );
+
+         std::lock_guard<std::mutex> g( _mtx );
+         auto itr = _entries.find( key );
+         if( itr == _entries.end() ) {
+            _lru.push_front( key );
+            itr = _entries.emplace( key, entry{ found, std::string( packed_abi ), _lru.begin() } ).first;
+         } else {
+            entry& e = itr->second;
+            if( e.packed_abi != packed_abi ) {
+               e.packed_abi = std::string( packed_abi );
+               e.serializer = found.serializer;
+               e.plan       = found.plan;
+            } else if( !e.plan ) {
+               e.plan = found.plan;
+            }
+            _lru.splice( _lru.begin(), _lru, e.lru );
+         }
+         found = itr->second;
+         while( _entries.size() > _max_entries ) {
+            _entries.erase( _lru.back() );
+            _lru.pop_back();
+         }
+         return found;
+      }
+
+      const size_t                   _max_entries;
+      mutable std::mutex             _mtx;
+      std::list<key_type>            _lru; ///< most recently used first
+      std::map<key_type, entry>      _entries;
+};
+
+} } // inery::chain
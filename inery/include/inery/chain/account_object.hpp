@@ -18,9 +18,7 @@ namespace inery { namespace chain {
       shared_blob          abi;
 
       void set_abi( const inery::chain::abi_def& a ) {
-         abi.resize( fc::raw::pack_size( a ) );
-         fc::datastream<char*> ds( abi.data(), abi.size() );
-         fc::raw::pack( ds, a );
+         fc::raw::pack_into( abi, a );
       }
 
       inery::chain::abi_def get_abi()const {
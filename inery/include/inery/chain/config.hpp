@@ -80,6 +80,7 @@ const static uint16_t   default_max_inline_action_depth              = 4;
 const static uint16_t   default_max_auth_depth                       = 6;
 const static uint32_t   default_sig_cpu_bill_pct                     = 50 * percent_1; // billable percentage of signature recovery
 const static uint32_t   default_block_cpu_effort_pct                 = 80 * percent_1; // percentage of block time used for producing block
+const static uint32_t   default_account_block_cpu_quota_pct          = 20 * percent_1; // share of block cpu an account may use before its trxs are deferred
 const static uint16_t   default_controller_thread_pool_size          = 2;
 const static uint32_t   default_max_variable_signature_length        = 16384u;
 const static uint32_t   default_max_nonprivileged_inline_action_size = 4 * 1024; // 4 KB
@@ -99,6 +100,7 @@ const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call
 
 const static inery::chain::wasm_interface::vm_type default_wasm_runtime = inery::chain::wasm_interface::vm_type::wabt;
 const static uint32_t   default_abi_serializer_max_time_us = 15*10000; ///< default deadline for abi serialization methods
+const static uint32_t   default_abi_serializer_cache_size = 1024; ///< contract ABIs kept deserialized by abi_serializer_cache::instance()
 
 /**
  *  The number of sequential blocks produced by a single producer
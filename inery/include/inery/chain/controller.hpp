@@ -6,6 +6,7 @@
 #include <boost/signals2/signal.hpp>
 
 #include <inery/chain/abi_serializer.hpp>
+#include <inery/chain/abi_serializer_cache.hpp>
 #include <inery/chain/account_object.hpp>
 #include <inery/chain/snapshot.hpp>
 #include <inery/chain/protocol_feature_manager.hpp>
@@ -336,11 +337,23 @@ namespace inery { namespace chain {
             return optional<abi_serializer>();
          }
 
+         /// @return the cached serializer of n's ABI, or null when n has no valid ABI
+         std::shared_ptr<const abi_serializer> get_shared_abi_serializer( account_name n, const abi_serializer::yield_function_t& yield )const {
+            if( n.good() ) {
+               try {
+                  const auto& a = get_account( n );
+                  const auto& m = db().get<account_metadata_object, by_name>( n );
+                  return abi_serializer_cache::instance().get( get_chain_id(), n, m.abi_sequence, std::string_view( a.abi.data(), a.abi.size() ), yield );
+               } FC_CAPTURE_AND_LOG((n))
+            }
+            return nullptr;
+         }
+
          template<typename T>
          fc::variant to_variant_with_abi( const T& obj, const abi_serializer::yield_function_t& yield ) {
             fc::variant pretty_output;
             abi_serializer::to_variant( obj, pretty_output,
-                                        [&]( account_name n ){ return get_abi_serializer( n, yield ); }, yield );
+                                        [&]( account_name n ){ return get_shared_abi_serializer( n, yield ); }, yield );
             return pretty_output;
          }
 
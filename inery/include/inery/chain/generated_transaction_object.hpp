@@ -34,11 +34,8 @@ namespace inery { namespace chain {
          shared_blob                   packed_trx;
 
          uint32_t set( const transaction& trx ) {
-            auto trxsize = fc::raw::pack_size( trx );
-            packed_trx.resize( trxsize );
-            fc::datastream<char*> ds( packed_trx.data(), trxsize );
-            fc::raw::pack( ds, trx );
-            return trxsize;
+            fc::raw::pack_into( packed_trx, trx );
+            return packed_trx.size();
          }
    };
 
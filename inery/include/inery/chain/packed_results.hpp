@@ -0,0 +1,198 @@
+#pragma once
+
+#include <inery/chain/controller.hpp>
+#include <inery/chain/account_object.hpp>
+#include <inery/chain/contract_table_objects.hpp>
+#include <inery/chain/abi_serializer.hpp>
+#include <inery/chain/exceptions.hpp>
+
+#include <string_view>
+
+namespace inery { namespace chain { namespace packed_results {
+
+/**
+ * fc::raw encoded results of block, table row and account queries, for consumers that would rather skip fc::variant
+ * and JSON on both ends.
+ *
+ * The write_* functions read from the controller and chainbase and pack straight into any fc datastream. Row data and
+ * ABIs are written as the bytes stored in chainbase. A response is a header followed by one of the results below, and
+ * clients unpack it with decode<Result>(). Bytes fields are views into the response, which must outlive the result;
+ * rows are turned into variants with the ABI sent along, if at all, on the client.
+ */
+
+/// media type of the encoding, negotiated through the Accept and Content-Type headers
+constexpr char content_type[] = "application/x-inery-packed";
+
+enum class result_kind : uint8_t {
+   block      = 1,
+   table_rows = 2,
+   account    = 3,
+};
+
+struct header {
+   static constexpr uint32_t current_version = 1;
+
+   uint32_t version = current_version;
+   uint8_t  kind    = 0; ///< result_kind
+};
+
+struct block_result {
+   static constexpr result_kind kind = result_kind::block;
+
+   uint32_t         block_num = 0;
+   block_id_type    id;
+   std::string_view block; ///< packed signed_block
+
+   signed_block unpack_block()const {
+      signed_block b;
+      fc::datastream<const char*> ds( block.data(), block.size() );
+      fc::raw::unpack( ds, b );
+      return b;
+   }
+};
+
+struct table_row {
+   uint64_t         primary_key = 0;
+   account_name     payer;
+   std::string_view value; ///< packed row, of the row type of the table in the ABI of the code
+};
+
+struct table_rows_result {
+   static constexpr result_kind kind = result_kind::table_rows;
+
+   account_name            code;
+   scope_name              scope;
+   table_name              table;
+   uint64_t                abi_sequence = 0;
+   std::string_view        abi;  ///< packed abi_def of code, empty if code has no ABI
+   std::vector<table_row>  rows;
+   bool                    more = false;
+   uint64_t                next_primary_key = 0; ///< lower bound of the next page if more
+
+   /// @return row decoded as the row type of table
+   fc::variant row_to_variant( const table_row& row, const abi_serializer& abis, const abi_serializer::yield_function_t& yield )const {
+      fc::datastream<const char*> ds( row.value.data(), row.value.size() );
+      return abis.binary_to_variant( abis.get_table_type( table ), ds, yield );
+   }
+};
+
+struct account_result {
+   static constexpr result_kind kind = result_kind::account;
+
+   account_name         name;
+   block_timestamp_type creation_date;
+   bool                 privileged = false;
+   uint64_t             recv_sequence = 0;
+   uint64_t             auth_sequence = 0;
+   uint64_t             code_sequence = 0;
+   uint64_t             abi_sequence  = 0;
+   digest_type          code_hash;
+   time_point           last_code_update;
+   uint8_t              vm_type = 0;
+   uint8_t              vm_version = 0;
+   std::string_view     abi; ///< packed abi_def, empty if the account has no ABI
+};
+
+template<typename Stream, typename Result>
+void write( Stream& s, const Result& r ) {
+   fc::raw::pack( s, header{ header::current_version, static_cast<uint8_t>( Result::kind ) } );
+   fc::raw::pack( s, r );
+}
+
+/// writes a block_result for b; the block is packed once and written after its length
+template<typename Stream>
+void write_block( Stream& s, const signed_block& b ) {
+   fc::raw::pack( s, header{ header::current_version, static_cast<uint8_t>( result_kind::block ) } );
+   fc::raw::pack( s, b.block_num() );
+   fc::raw::pack( s, b.id() );
+   fc::raw::detail::with_packed( [&]( const char* data, size_t size ) {
+      fc::raw::pack( s, unsigned_int( size ) );
+      s.write( data, size );
+   }, b );
+}
+
+template<typename Stream>
+void write_block( Stream& s, const controller& chain, uint32_t block_num ) {
+   const signed_block_ptr b = chain.fetch_block_by_number( block_num );
+   INE_ASSERT( b, unknown_block_exception, "Could not find block: ${block}", ("block", block_num) );
+   write_block( s, *b );
+}
+
+/// writes the rows of table with primary keys in [lower, upper], at most limit of them, which must not be 0
+template<typename Stream>
+void write_table_rows( Stream& s, const controller& chain, account_name code, scope_name scope, table_name table,
+                       uint64_t lower = 0, uint64_t upper = std::numeric_limits<uint64_t>::max(), uint32_t limit = 10 ) {
+   FC_ASSERT( limit > 0, "limit must be at least 1" );
+   FC_ASSERT( lower <= upper, "lower bound ${l} is above upper bound ${u}", ("l", lower)("u", upper) );
+   const auto& db = chain.db();
+
+   table_rows_result r;
+   r.code  = code;
+   r.scope = scope;
+   r.table = table;
+   if( const auto* meta = db.find<account_metadata_object, by_name>( code ) )
+      r.abi_sequence = meta->abi_sequence;
+   if( const auto* acnt = db.find<account_object, by_name>( code ) )
+      r.abi = std::string_view( acnt->abi.data(), acnt->abi.size() );
+
+   if( const auto* t_id = db.find<table_id_object, by_code_scope_table>( boost::make_tuple( code, scope, table ) ) ) {
+      const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+      auto itr = idx.lower_bound( boost::make_tuple( t_id->id, lower ) );
+      const auto end = idx.upper_bound( boost::make_tuple( t_id->id, upper ) );
+      for( ; itr != end; ++itr ) {
+         if( r.rows.size() == limit ) {
+            r.more = true;
+            r.next_primary_key = itr->primary_key;
+            break;
+         }
+         r.rows.push_back( table_row{ itr->primary_key, itr->payer, std::string_view( itr->value.data(), itr->value.size() ) } );
+      }
+   }
+   write( s, r );
+}
+
+template<typename Stream>
+void write_account( Stream& s, const controller& chain, account_name name ) {
+   const auto& db = chain.db();
+   const auto& acnt = db.get<account_object, by_name>( name );
+   const auto& meta = db.get<account_metadata_object, by_name>( name );
+
+   account_result r;
+   r.name             = name;
+   r.creation_date    = acnt.creation_date;
+   r.privileged       = meta.is_privileged();
+   r.recv_sequence    = meta.recv_sequence;
+   r.auth_sequence    = meta.auth_sequence;
+   r.code_sequence    = meta.code_sequence;
+   r.abi_sequence     = meta.abi_sequence;
+   r.code_hash        = meta.code_hash;
+   r.last_code_update = meta.last_code_update;
+   r.vm_type          = meta.vm_type;
+   r.vm_version       = meta.vm_version;
+   r.abi              = std::string_view( acnt.abi.data(), acnt.abi.size() );
+   write( s, r );
+}
+
+/// Client side. Unpacks response, throwing if it holds another kind of result or is of a newer version.
+template<typename Result>
+Result decode( const std::string_view& response ) {
+   fc::datastream<const char*> ds( response.data(), response.size() );
+   header h;
+   fc::raw::unpack( ds, h );
+   INE_ASSERT( h.version <= header::current_version, unsupported_feature,
+               "Unsupported packed result version ${v}", ("v", h.version) );
+   FC_ASSERT( h.kind == static_cast<uint8_t>( Result::kind ), "Expected packed result of kind ${e}, got ${k}",
+              ("e", static_cast<uint8_t>( Result::kind ))("k", h.kind) );
+   Result r;
+   fc::raw::unpack( ds, r );
+   return r;
+}
+
+} } } // inery::chain::packed_results
+
+FC_REFLECT( inery::chain::packed_results::header, (version)(kind) )
+FC_REFLECT( inery::chain::packed_results::block_result, (block_num)(id)(block) )
+FC_REFLECT( inery::chain::packed_results::table_row, (primary_key)(payer)(value) )
+FC_REFLECT( inery::chain::packed_results::table_rows_result, (code)(scope)(table)(abi_sequence)(abi)(rows)(more)(next_primary_key) )
+FC_REFLECT( inery::chain::packed_results::account_result, (name)(creation_date)(privileged)(recv_sequence)(auth_sequence)
+            (code_sequence)(abi_sequence)(code_hash)(last_code_update)(vm_type)(vm_version)(abi) )
@@ -16,9 +16,7 @@ namespace inery { namespace chain {
       shared_string  packedblock;
 
       void set_block( const signed_block_ptr& b ) {
-         packedblock.resize( fc::raw::pack_size( *b ) );
-         fc::datastream<char*> ds( packedblock.data(), packedblock.size() );
-         fc::raw::pack( ds, *b );
+         fc::raw::pack_into( packedblock, *b );
       }
 
       signed_block_ptr get_block()const {
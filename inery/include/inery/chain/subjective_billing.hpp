@@ -0,0 +1,99 @@
+#pragma once
+
+#include <inery/chain/resource_limits.hpp>
+#include <inery/chain/resource_limits_private.hpp>
+#include <inery/chain/exceptions.hpp>
+
+#include <map>
+
+namespace inery { namespace chain {
+
+   /**
+    * Node-local ledger of the cpu burned by transactions which failed or expired before making it into a block.
+    *
+    * Such transactions cost the producer cpu but are billed to nobody on chain. The ledger charges that cpu to the
+    * authorizing accounts with the same exponential decay the chain uses for objective cpu usage (24h window), and
+    * check() rejects new transactions of an account whose subjective bill already consumes the cpu it has available
+    * according to resource_limits_manager. Nothing here affects consensus.
+    */
+   class subjective_billing {
+   public:
+      static constexpr uint32_t time_interval_ms = config::block_interval_ms;
+      static constexpr uint32_t window_size      = config::account_cpu_usage_average_window_ms / time_interval_ms;
+
+      void disable() { _disabled = true; }
+      bool is_disabled()const { return _disabled; }
+
+      /// charge elapsed, the cpu spent on a subjectively failed or expired transaction, to every account in bill_to
+      void subjective_bill_failed( const flat_set<account_name>& bill_to, fc::microseconds elapsed, fc::time_point now ) {
+         if( _disabled || elapsed.count() <= 0 ) return;
+         const uint32_t ordinal = time_ordinal( now );
+         for( const auto& a : bill_to ) {
+            auto& acc = _account_bill[a];
+            // the accumulator rejects going back in time, which the wall clock may do
+            acc.add( elapsed.count(), std::max( ordinal, acc.last_ordinal ), window_size );
+         }
+      }
+
+      /// @return decayed cpu in microseconds currently owed by account
+      int64_t get_subjective_bill( const account_name& account, fc::time_point now )const {
+         if( _disabled ) return 0;
+         auto itr = _account_bill.find( account );
+         if( itr == _account_bill.end() ) return 0;
+         return decayed_bill( itr->second, time_ordinal( now ) );
+      }
+
+      /**
+       * Throws tx_cpu_usage_exceeded when the subjective bill of account consumes all the cpu available to it.
+       * Call before executing a new transaction for each account that would be billed.
+       */
+      void check( const resource_limits::resource_limits_manager& rlm, const account_name& account, fc::time_point now,
+                  uint32_t greylist_limit = config::maximum_elastic_resource_multiplier )const {
+         const int64_t bill = get_subjective_bill( account, now );
+         if( bill == 0 ) return;
+         const auto limit = rlm.get_account_cpu_limit_ex( account, greylist_limit ).first;
+         if( limit.available < 0 ) return; // unlimited
+         INE_ASSERT( bill < limit.available, tx_cpu_usage_exceeded,
+                     "account ${a} has insufficient cpu: ${b}us subjectively billed for failed transactions, ${av}us available",
+                     ("a", account)("b", bill)("av", limit.available) );
+      }
+
+      /// drop accounts whose bill decayed to zero; bounded by deadline
+      void remove_expired( fc::time_point now, fc::time_point deadline ) {
+         const uint32_t ordinal = time_ordinal( now );
+         for( auto itr = _account_bill.begin(); itr != _account_bill.end(); ) {
+            if( fc::time_point::now() >= deadline ) break;
+            if( decayed_bill( itr->second, ordinal ) == 0 ) itr = _account_bill.erase( itr );
+            else ++itr;
+         }
+      }
+
+      size_t size()const { return _account_bill.size(); }
+
+   private:
+      using decaying_accumulator = resource_limits::impl::exponential_moving_average_accumulator<>;
+
+      static uint32_t time_ordinal( fc::time_point t ) {
+         return static_cast<uint32_t>( t.time_since_epoch().count() / ( time_interval_ms * 1000ll ) );
+      }
+
+      /// cpu in the window as of ordinal, i.e. what add() would leave after decaying without new usage
+      static int64_t decayed_bill( const decaying_accumulator& acc, uint32_t ordinal ) {
+         uint64_t value_ex = acc.value_ex;
+         if( ordinal > acc.last_ordinal ) {
+            if( (uint64_t)acc.last_ordinal + window_size > (uint64_t)ordinal ) {
+               const uint64_t delta = ordinal - acc.last_ordinal;
+               value_ex = static_cast<uint64_t>( (uint128_t)value_ex * ( window_size - delta ) / window_size );
+            } else {
+               value_ex = 0;
+            }
+         }
+         return static_cast<int64_t>( resource_limits::impl::integer_divide_ceil(
+                   (uint128_t)value_ex * window_size, (uint128_t)config::rate_limiting_precision ) );
+      }
+
+      std::map<account_name, decaying_accumulator> _account_bill;
+      bool                                         _disabled = false;
+   };
+
+} } // inery::chain
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <inery/chain/transaction_metadata.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace inery { namespace chain {
+
+/**
+ * Multi-producer intake stage in front of unapplied_transaction_queue.
+ *
+ * Network and http threads call push() concurrently. Duplicate and expired transactions are rejected right there and
+ * signature recovery is started on the supplied thread pool, so none of that work reaches the main thread. Accepted
+ * entries are linked onto a lock-free stack; the main thread (the single consumer) takes the whole stack at once in
+ * drain() and hands out, in arrival order, only the entries whose key recovery already completed.
+ *
+ * Duplicate detection is sharded by transaction id so concurrent producers rarely contend. An id stays known until the
+ * transaction expires or the main thread forgets it, e.g. after the transaction failed and may be retried.
+ */
+template<typename Payload>
+class unapplied_transaction_intake {
+public:
+   struct entry {
+      packed_transaction_ptr trx;
+      recover_keys_future    trx_meta; ///< completes with the transaction_metadata once keys are recovered
+      Payload                payload;  ///< caller context delivered together with the transaction, e.g. a reply callback
+   };
+
+   enum class push_result {
+      queued,
+      duplicate,
+      expired
+   };
+
+   unapplied_transaction_intake( boost::asio::io_context& thread_pool, const chain_id_type& chain_id,
+                                 fc::microseconds max_sig_recovery_time, uint32_t max_variable_sig_size )
+   : _thread_pool( thread_pool ), _chain_id( chain_id ),
+     _max_sig_recovery_time( max_sig_recovery_time ), _max_variable_sig_size( max_variable_sig_size ) {}
+
+   ~unapplied_transaction_intake() {
+      node* n = _head.exchange( nullptr, std::memory_order_acquire );
+      while( n ) {
+         node* next = n->next;
+         delete n;
+         n = next;
+      }
+   }
+
+   unapplied_transaction_intake( const unapplied_transaction_intake& ) = delete;
+   unapplied_transaction_intake& operator=( const unapplied_transaction_intake& ) = delete;
+
+   /// Thread safe.
+   push_result push( packed_transaction_ptr trx, Payload payload, fc::time_point now = fc::time_point::now() ) {
+      const fc::time_point expiry = trx->expiration();
+      if( expiry <= now ) {
+         _expired.fetch_add( 1, std::memory_order_relaxed );
+         return push_result::expired;
+      }
+
+      auto& s = shard_of( trx->id() );
+      {
+         std::lock_guard<std::mutex> g( s.mtx );
+         if( !s.known.emplace( trx->id(), expiry ).second ) {
+            _duplicates.fetch_add( 1, std::memory_order_relaxed );
+            return push_result::duplicate;
+         }
+         if( s.known.size() > s.purge_at ) {
+            for( auto itr = s.known.begin(); itr != s.known.end(); ) {
+               if( itr->second <= now ) itr = s.known.erase( itr );
+               else ++itr;
+            }
+            s.purge_at = std::max<size_t>( min_purge_size, 2 * s.known.size() );
+         }
+      }
+
+      auto fut = transaction_metadata::start_recover_keys( trx, _thread_pool, _chain_id, _max_sig_recovery_time,
+                                                           _max_variable_sig_size );
+      node* n = new node{ entry{ std::move( trx ), std::move( fut ), std::move( payload ) }, nullptr };
+      n->next = _head.load( std::memory_order_relaxed );
+      while( !_head.compare_exchange_weak( n->next, n, std::memory_order_release, std::memory_order_relaxed ) )
+         ;
+      _size.fetch_add( 1, std::memory_order_relaxed );
+      return push_result::queued;
+   }
+
+   /**
+    * Main thread only. Calls f(entry&&) for up to max_batch entries in arrival order whose key recovery finished,
+    * successfully or not. Entries still recovering keys are kept, in order, for a later drain. Linear in the number
+    * of pending entries. If f throws, the ready entries not yet passed to it are dropped.
+    * @return number of entries passed to f
+    */
+   template<typename F>
+   size_t drain( size_t max_batch, F&& f ) {
+      // the stack is newest first; reverse it so that _pending stays in arrival order
+      node* reversed = nullptr;
+      for( node* n = _head.exchange( nullptr, std::memory_order_acquire ); n; ) {
+         node* next = n->next;
+         n->next = reversed;
+         reversed = n;
+         n = next;
+      }
+      for( node* n = reversed; n; ) {
+         node* next = n->next;
+         _pending.emplace_back( std::move( n->value ) );
+         delete n;
+         n = next;
+      }
+
+      // move the ready entries out and compact the rest in one pass, keeping both in arrival order
+      _ready.clear();
+      auto keep = _pending.begin();
+      auto itr = _pending.begin();
+      for( ; itr != _pending.end() && _ready.size() < max_batch; ++itr ) {
+         if( itr->trx_meta.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ) {
+            _ready.emplace_back( std::move( *itr ) );
+         } else {
+            if( keep != itr ) *keep = std::move( *itr );
+            ++keep;
+         }
+      }
+      if( keep != itr )
+         _pending.erase( std::move( itr, _pending.end(), keep ), _pending.end() );
+      _size.fetch_sub( _ready.size(), std::memory_order_relaxed );
+
+      for( auto& e : _ready )
+         f( std::move( e ) );
+      const size_t drained = _ready.size();
+      _ready.clear();
+      return drained;
+   }
+
+   /// Thread safe. Allow id to be pushed again, for example after its transaction failed.
+   void forget( const transaction_id_type& id ) {
+      auto& s = shard_of( id );
+      std::lock_guard<std::mutex> g( s.mtx );
+      s.known.erase( id );
+   }
+
+   /// Thread safe. Approximate number of queued entries.
+   size_t size()const { return _size.load( std::memory_order_relaxed ); }
+
+   uint64_t duplicates()const { return _duplicates.load( std::memory_order_relaxed ); }
+   uint64_t expired()const    { return _expired.load( std::memory_order_relaxed ); }
+
+private:
+   struct node {
+      entry value;
+      node* next;
+   };
+
+   struct id_hash {
+      size_t operator()( const transaction_id_type& id )const { return id._hash[3]; }
+   };
+
+   static constexpr size_t num_shards    = 16;
+   static constexpr size_t min_purge_size = 1024;
+
+   struct shard {
+      std::mutex                                                          mtx;
+      std::unordered_map<transaction_id_type, fc::time_point, id_hash>    known;
+      size_t                                                              purge_at = min_purge_size;
+   };
+
+   shard& shard_of( const transaction_id_type& id ) { return _shards[id._hash[2] % num_shards]; }
+
+   boost::asio::io_context&   _thread_pool;
+   const chain_id_type        _chain_id;
+   const fc::microseconds     _max_sig_recovery_time;
+   const uint32_t             _max_variable_sig_size;
+
+   std::atomic<node*>         _head{nullptr};
+   std::deque<entry>          _pending; ///< main thread only
+   std::vector<entry>         _ready;   ///< main thread only, reused by drain()
+   std::atomic<size_t>        _size{0};
+   std::atomic<uint64_t>      _duplicates{0};
+   std::atomic<uint64_t>      _expired{0};
+   std::array<shard, num_shards> _shards;
+};
+
+} } //inery::chain
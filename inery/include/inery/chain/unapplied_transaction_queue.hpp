@@ -3,11 +3,16 @@
 #include <inery/chain/transaction_metadata.hpp>
 #include <inery/chain/block_state.hpp>
 #include <inery/chain/exceptions.hpp>
+#include <inery/chain/trace.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+#include <list>
+#include <map>
 
 namespace fc {
   inline std::size_t hash_value( const fc::sha256& v ) {
@@ -30,6 +35,7 @@ struct unapplied_transaction {
    const transaction_metadata_ptr trx_meta;
    const fc::time_point           expiry;
    trx_enum_type                  trx_type = trx_enum_type::unknown;
+   uint32_t                       estimated_cpu_us = 0; ///< from action_cpu_estimator when queued
 
    const transaction_id_type& id()const { return trx_meta->id(); }
 
@@ -39,6 +45,97 @@ struct unapplied_transaction {
    unapplied_transaction(unapplied_transaction&&) = default;
 };
 
+/**
+ * Learns the cpu cost of actions from the traces of applied transactions.
+ *
+ * The billed cpu of a transaction is split evenly over its top-level actions (inline actions and notifications are
+ * attributed to the action that caused them) and folded into an exponentially weighted moving average per
+ * (contract, action). Unknown actions are estimated at default_cpu_us. Beyond max_tracked_actions, the action recorded
+ * least recently is forgotten.
+ */
+class action_cpu_estimator {
+public:
+   explicit action_cpu_estimator( uint32_t default_cpu_us = config::default_min_transaction_cpu_usage,
+                                  size_t max_tracked_actions = 64*1024 )
+   : default_cpu_us( default_cpu_us ), max_tracked_actions( max_tracked_actions ) {}
+
+   void record( const transaction_trace& trace ) {
+      if( !trace.receipt || trace.except ) return;
+      uint32_t top_level = 0;
+      for( const auto& at : trace.action_traces )
+         if( at.creator_action_ordinal.value == 0 && at.receiver == at.act.account ) ++top_level;
+      if( top_level == 0 ) return;
+
+      const uint32_t per_action_us = trace.receipt->cpu_usage_us / top_level;
+      for( const auto& at : trace.action_traces ) {
+         if( at.creator_action_ordinal.value != 0 || at.receiver != at.act.account ) continue;
+         const key_type key( at.act.account, at.act.name );
+         auto itr = averages.find( key );
+         if( itr == averages.end() ) {
+            if( averages.size() >= max_tracked_actions ) {
+               averages.erase( lru.back() );
+               lru.pop_back();
+            }
+            lru.push_front( key );
+            averages.emplace( key, average{ per_action_us, lru.begin() } );
+         } else {
+            // ewma with weight 1/8 for the new sample
+            itr->second.cpu_us = static_cast<uint32_t>( ( uint64_t(itr->second.cpu_us) * 7 + per_action_us ) / 8 );
+            lru.splice( lru.begin(), lru, itr->second.lru );
+         }
+      }
+   }
+
+   uint32_t estimate( const transaction& trx )const {
+      uint64_t cpu_us = 0;
+      for( const auto& act : trx.actions ) {
+         auto itr = averages.find( std::make_pair( act.account, act.name ) );
+         cpu_us += itr == averages.end() ? default_cpu_us : itr->second.cpu_us;
+      }
+      return static_cast<uint32_t>( std::min<uint64_t>( cpu_us, std::numeric_limits<uint32_t>::max() ) );
+   }
+
+   size_t size()const { return averages.size(); }
+
+private:
+   using key_type = std::pair<account_name, action_name>;
+
+   struct average {
+      uint32_t                       cpu_us = 0;
+      std::list<key_type>::iterator  lru;
+   };
+
+   std::map<key_type, average> averages;
+   std::list<key_type>         lru; ///< most recently recorded first; the last one is evicted when full
+   uint32_t default_cpu_us;
+   size_t   max_tracked_actions;
+};
+
+/**
+ * Per-account fairness quota for a single block.
+ *
+ * Each account may consume up to quota_pct of the block cpu (by estimate when scheduled, corrected with the billed cpu
+ * once applied) before its remaining transactions are deferred behind those of every other account.
+ */
+class account_cpu_quota {
+public:
+   void start_block( uint32_t block_cpu_limit_us, uint32_t quota_pct = config::default_account_block_cpu_quota_pct ) {
+      quota_us = INE_PERCENT( block_cpu_limit_us, quota_pct );
+      used.clear();
+   }
+
+   bool within_quota( account_name a, uint32_t cpu_us )const {
+      auto itr = used.find( a );
+      return itr == used.end() || itr->second + cpu_us <= quota_us;
+   }
+
+   void charge( account_name a, uint32_t cpu_us ) { used[a] += cpu_us; }
+
+private:
+   uint64_t                      quota_us = std::numeric_limits<uint64_t>::max();
+   std::map<account_name, uint64_t> used;
+};
+
 /**
  * Track unapplied transactions for persisted, forked blocks, and aborted blocks.
  * Persisted are first so that they can be applied in each block until expired.
@@ -55,6 +152,7 @@ private:
    struct by_trx_id;
    struct by_type;
    struct by_expiry;
+   struct by_priority;
 
    typedef multi_index_container< unapplied_transaction,
       indexed_by<
@@ -62,12 +160,23 @@ private:
                const_mem_fun<unapplied_transaction, const transaction_id_type&, &unapplied_transaction::id>
          >,
          ordered_non_unique< tag<by_type>, member<unapplied_transaction, trx_enum_type, &unapplied_transaction::trx_type> >,
-         ordered_non_unique< tag<by_expiry>, member<unapplied_transaction, const fc::time_point, &unapplied_transaction::expiry> >
+         ordered_non_unique< tag<by_expiry>, member<unapplied_transaction, const fc::time_point, &unapplied_transaction::expiry> >,
+         ordered_non_unique< tag<by_priority>,
+               composite_key< unapplied_transaction,
+                  member<unapplied_transaction, trx_enum_type, &unapplied_transaction::trx_type>,
+                  member<unapplied_transaction, uint32_t, &unapplied_transaction::estimated_cpu_us>
+               >
+         >
       >
    > unapplied_trx_queue_type;
 
    unapplied_trx_queue_type queue;
    process_mode mode = process_mode::speculative_producer;
+   action_cpu_estimator cpu_estimator;
+
+   uint32_t estimate( const transaction_metadata_ptr& trx )const {
+      return cpu_estimator.estimate( trx->packed_trx()->get_transaction() );
+   }
 
 public:
 
@@ -143,7 +252,7 @@ public:
          for( auto itr = bsptr->trxs_metas().begin(), end = bsptr->trxs_metas().end(); itr != end; ++itr ) {
             const auto& trx = *itr;
             fc::time_point expiry = trx->packed_trx()->expiration();
-            queue.insert( { trx, expiry, trx_enum_type::forked } );
+            queue.insert( { trx, expiry, trx_enum_type::forked, estimate( trx ) } );
          }
       }
    }
@@ -152,7 +261,8 @@ public:
       if( mode == process_mode::non_speculative || mode == process_mode::speculative_non_producer ) return;
       for( auto& trx : aborted_trxs ) {
          fc::time_point expiry = trx->packed_trx()->expiration();
-         queue.insert( { std::move( trx ), expiry, trx_enum_type::aborted } );
+         uint32_t est = estimate( trx );
+         queue.insert( { std::move( trx ), expiry, trx_enum_type::aborted, est } );
       }
    }
 
@@ -161,7 +271,7 @@ public:
       auto itr = queue.get<by_trx_id>().find( trx->id() );
       if( itr == queue.get<by_trx_id>().end() ) {
          fc::time_point expiry = trx->packed_trx()->expiration();
-         queue.insert( { trx, expiry, trx_enum_type::persisted } );
+         queue.insert( { trx, expiry, trx_enum_type::persisted, estimate( trx ) } );
       } else if( itr->trx_type != trx_enum_type::persisted ) {
          queue.get<by_trx_id>().modify( itr, [](auto& un){
             un.trx_type = trx_enum_type::persisted;
@@ -179,6 +289,70 @@ public:
 
    iterator erase( iterator itr ) { return queue.get<by_type>().erase( itr ); }
 
+   /// Same grouping as begin()/end() but cheapest estimated cpu first within each trx_enum_type
+   using priority_iterator = unapplied_trx_queue_type::index<by_priority>::type::iterator;
+
+   priority_iterator priority_begin() { return queue.get<by_priority>().begin(); }
+   priority_iterator priority_end() { return queue.get<by_priority>().end(); }
+
+   priority_iterator erase( priority_iterator itr ) { return queue.get<by_priority>().erase( itr ); }
+
+   /// feed the trace of every applied transaction so that estimates follow actual costs
+   void record_trace( const transaction_trace& trace ) { cpu_estimator.record( trace ); }
+
+   const action_cpu_estimator& get_cpu_estimator()const { return cpu_estimator; }
+
+   /**
+    * Scheduling policy for a block: visit all non-persisted transactions cheapest first, deferring transactions of
+    * accounts that used up their quota until every other account has been served.
+    *
+    * Cheapest first alone would starve a costly transaction for as long as cheaper ones keep arriving, until it
+    * expires. So transactions that expire before expiring_before are aged: they are visited ahead of all others,
+    * soonest expiry first, regardless of cost and quota.
+    *
+    * f(priority_iterator) may erase the entry and returns std::pair<bool, uint32_t>: whether to continue and the cpu
+    * billed to the first authorizer (0 if the transaction was not applied).
+    */
+   template<typename F>
+   void schedule_by_priority( account_cpu_quota& quota, const fc::time_point& expiring_before, F&& f ) {
+      auto& exp_idx = queue.get<by_expiry>();
+      for( auto itr = exp_idx.begin(); itr != exp_idx.end() && itr->expiry < expiring_before; ) {
+         auto next = std::next( itr );
+         if( itr->trx_type != trx_enum_type::persisted ) {
+            const account_name first_auth = itr->trx_meta->packed_trx()->get_transaction().first_authorizer();
+            auto r = f( queue.project<by_priority>( itr ) );
+            quota.charge( first_auth, r.second );
+            if( !r.first ) return;
+         }
+         itr = next;
+      }
+
+      std::vector<transaction_id_type> deferred;
+      auto& idx = queue.get<by_priority>();
+      for( auto itr = idx.upper_bound( trx_enum_type::persisted ); itr != idx.end(); ) {
+         auto next = std::next( itr );
+         if( itr->expiry < expiring_before ) { // aged, already visited
+            itr = next;
+            continue;
+         }
+         const account_name first_auth = itr->trx_meta->packed_trx()->get_transaction().first_authorizer();
+         if( !quota.within_quota( first_auth, itr->estimated_cpu_us ) ) {
+            deferred.push_back( itr->id() );
+         } else {
+            auto r = f( itr );
+            quota.charge( first_auth, r.second );
+            if( !r.first ) return;
+         }
+         itr = next;
+      }
+      for( const auto& id : deferred ) {
+         auto id_itr = queue.get<by_trx_id>().find( id );
+         if( id_itr == queue.get<by_trx_id>().end() ) continue;
+         auto r = f( queue.project<by_priority>( id_itr ) );
+         if( !r.first ) return;
+      }
+   }
+
 };
 
 } } //inery::chain
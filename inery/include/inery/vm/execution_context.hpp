@@ -5,6 +5,7 @@
 #include <inery/vm/exceptions.hpp>
 #include <inery/vm/host_function.hpp>
 #include <inery/vm/opcodes.hpp>
+#include <inery/vm/profile.hpp>
 #include <inery/vm/signals.hpp>
 #include <inery/vm/types.hpp>
 #include <inery/vm/utils.hpp>
@@ -205,6 +206,7 @@ namespace inery { namespace vm {
                   stack = alt_stack.get() + maximum_stack_usage;
                }
                auto fn = reinterpret_cast<native_value (*)(void*, void*)>(_mod.code[func_index - _mod.get_imported_functions_size()].jit_code_offset + _mod.allocator._code_base);
+               detail::profile_stack_guard profile_guard(stack ? stack : __builtin_frame_address(0));
 
                vm::invoke_with_signal_handler([&]() {
                   result = execute<sizeof...(Args)>(args_raw, fn, this, _linear_memory, stack);
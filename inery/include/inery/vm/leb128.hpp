@@ -6,10 +6,25 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <type_traits>
 
 namespace inery { namespace vm {
+   namespace detail {
+      /// Length of the leb128 at p, found with one 8 byte load instead of a branch per byte;
+      /// 0 when all of the 8 bytes have the continuation bit set. p must have 8 readable bytes.
+      inline uint32_t leb128_length(const uint8_t* p) {
+         uint64_t word;
+         memcpy(&word, p, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+         word = __builtin_bswap64(word);
+#endif
+         const uint64_t stops = ~word & 0x8080808080808080ull;
+         return stops ? (__builtin_ctzll(stops) >> 3) + 1 : 0;
+      }
+   } // namespace detail
+
    template <size_t N>
    inline size_t constexpr bytes_needed() {
       if constexpr (N == 1 || N == 7)
@@ -49,18 +64,10 @@ namespace inery { namespace vm {
          }
          
          inline constexpr void from( guarded_ptr<uint8_t>& code ) {
-            uint8_t cnt = 0;
-            for (;; cnt++) {
-               INE_VM_ASSERT( cnt < bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
-               INE_VM_ASSERT( code.offset()+cnt < code.bounds(), wasm_interpreter_exception, "pointer out of bounds" );
-               storage[cnt] = code[cnt];
-               if ((storage[cnt] & 0x80) == 0) {
-                  if( cnt + 1 == bytes_needed<N>() ) {
-                     uint8_t mask = static_cast<uint8_t>(~(uint32_t)0 << uint32_t(N - 7*(bytes_needed<N>()-1))) & 0x7F;
-                     INE_VM_ASSERT((mask & storage[cnt]) == 0, wasm_parse_exception, "unused bits of unsigned leb128 must be 0");
-                  }
-                  break;
-               }
+            const uint8_t cnt = read(code);
+            if( cnt + 1 == bytes_needed<N>() ) {
+               uint8_t mask = static_cast<uint8_t>(~(uint32_t)0 << uint32_t(N - 7*(bytes_needed<N>()-1))) & 0x7F;
+               INE_VM_ASSERT((mask & storage[cnt]) == 0, wasm_parse_exception, "unused bits of unsigned leb128 must be 0");
             }
             code += cnt+1;
             bytes_used = cnt+1;
@@ -93,6 +100,25 @@ namespace inery { namespace vm {
          }
       
       private:
+         /// copies the encoding at code into storage without advancing code; @return the index of its last byte
+         inline uint8_t read( guarded_ptr<uint8_t>& code ) {
+            if( code.bounds() - code.offset() >= sizeof(uint64_t) ) {
+               if( const uint32_t len = detail::leb128_length(code.raw()) ) {
+                  INE_VM_ASSERT( len <= bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
+                  memcpy(storage.data(), code.raw(), len);
+                  return len - 1;
+               }
+            }
+            uint8_t cnt = 0;
+            for (;; cnt++) {
+               INE_VM_ASSERT( cnt < bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
+               INE_VM_ASSERT( code.offset()+cnt < code.bounds(), wasm_interpreter_exception, "pointer out of bounds" );
+               storage[cnt] = code[cnt];
+               if ((storage[cnt] & 0x80) == 0)
+                  return cnt;
+            }
+         }
+
          std::array<uint8_t, bytes_needed<N>()> storage;
          uint8_t bytes_used = bytes_needed<N>(); 
    };
@@ -121,20 +147,12 @@ namespace inery { namespace vm {
          }
          
          inline constexpr void from( guarded_ptr<uint8_t>& code ) {
-            uint8_t cnt = 0;
-            for (;; cnt++) {
-               INE_VM_ASSERT( cnt < bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
-               INE_VM_ASSERT( code.offset()+cnt < code.bounds(), wasm_interpreter_exception, "pointer out of bounds" );
-               storage[cnt] = code[cnt];
-               if ((storage[cnt] & 0x80) == 0) {
-                  if( cnt + 1 == bytes_needed<N>() ) {
-                    uint32_t offset = N - 7*(bytes_needed<N>()-1);
-                     uint8_t mask = static_cast<uint8_t>(~(uint32_t)0 << offset) & 0x7F;
-                     uint8_t expected = (storage[cnt] & (uint32_t(1) << uint32_t(offset - 1)))? mask : 0;
-                     INE_VM_ASSERT((mask & storage[cnt]) == expected, wasm_parse_exception, "unused bits of signed leb128 must be the same as the sign bit");
-                  }
-                  break;
-               }
+            const uint8_t cnt = read(code);
+            if( cnt + 1 == bytes_needed<N>() ) {
+               uint32_t offset = N - 7*(bytes_needed<N>()-1);
+               uint8_t mask = static_cast<uint8_t>(~(uint32_t)0 << offset) & 0x7F;
+               uint8_t expected = (storage[cnt] & (uint32_t(1) << uint32_t(offset - 1)))? mask : 0;
+               INE_VM_ASSERT((mask & storage[cnt]) == expected, wasm_parse_exception, "unused bits of signed leb128 must be the same as the sign bit");
             }
             code += cnt+1;
             bytes_used = cnt+1;
@@ -166,6 +184,25 @@ namespace inery { namespace vm {
          }
       
       private:
+         /// copies the encoding at code into storage without advancing code; @return the index of its last byte
+         inline uint8_t read( guarded_ptr<uint8_t>& code ) {
+            if( code.bounds() - code.offset() >= sizeof(uint64_t) ) {
+               if( const uint32_t len = detail::leb128_length(code.raw()) ) {
+                  INE_VM_ASSERT( len <= bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
+                  memcpy(storage.data(), code.raw(), len);
+                  return len - 1;
+               }
+            }
+            uint8_t cnt = 0;
+            for (;; cnt++) {
+               INE_VM_ASSERT( cnt < bytes_needed<N>(), wasm_interpreter_exception, "incorrect leb128 encoding" );
+               INE_VM_ASSERT( code.offset()+cnt < code.bounds(), wasm_interpreter_exception, "pointer out of bounds" );
+               storage[cnt] = code[cnt];
+               if ((storage[cnt] & 0x80) == 0)
+                  return cnt;
+            }
+         }
+
          template <typename T>
          inline constexpr void _from(T v) {
             bytes_used = 0;
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <inery/vm/guarded_ptr.hpp>
+#include <inery/vm/leb128.hpp>
+#include <inery/vm/sections.hpp>
+#include <inery/vm/types.hpp>
+#include <inery/vm/utils.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace inery { namespace vm {
+
+   // Sampling profiler for code generated by machine_code_writer.
+   //
+   // While a profile_scope is alive, the thread receives SIGPROF at a fixed interval.  The
+   // handler records the interrupted instruction and walks the frame pointer chain that every
+   // jit function sets up, so each sample is a complete wasm call stack.  When the thread is
+   // inside a host function, the sample is attributed to the import and the wasm frames below it.
+   //
+   // Samples are resolved to function indices when the scope ends and aggregated into a
+   // profile_data, which can be written in the folded format of flamegraph.pl and speedscope.
+   //
+   // Limitations: a sample taken on the first two instructions or the final ret of a function
+   // loses the caller's frame, and samples in other native code called by wasm (softfloat,
+   // memory growth) are counted without a stack.
+   namespace detail {
+      constexpr std::size_t max_profile_frames  = 64;
+      constexpr std::size_t profile_buffer_size = 64 * 1024; // words, per thread
+
+      // Read by the SIGPROF handler of the same thread.  code_begin is written last when
+      // sampling starts and cleared first when it stops.
+      struct profile_thread_state {
+         uintptr_t   code_begin    = 0;
+         uintptr_t   code_end      = 0;
+         uintptr_t   stack_top     = 0; // frames at or above this address do not belong to wasm
+         // wasm caller of the running host function
+         uintptr_t   host_ip       = 0; // return address
+         uintptr_t   host_fp       = 0;
+         uint32_t    host_function = 0;
+         // each sample is a header word (frame count | (host_function + 1) << 32) followed by the frames, leaf first
+         uintptr_t*  buffer        = nullptr;
+         std::size_t size          = 0;
+         uint64_t    dropped       = 0;
+      };
+
+      inline thread_local profile_thread_state profile_state;
+      inline struct sigaction prev_profile_handler;
+
+      inline void profile_signal_handler(int sig, siginfo_t* info, void* uap) {
+         profile_thread_state& s = profile_state;
+         const uintptr_t begin = s.code_begin;
+         std::atomic_signal_fence(std::memory_order_acquire);
+         if (!begin) {
+            if (prev_profile_handler.sa_flags & SA_SIGINFO)
+               prev_profile_handler.sa_sigaction(sig, info, uap);
+            else if (prev_profile_handler.sa_handler != SIG_DFL && prev_profile_handler.sa_handler != SIG_IGN)
+               prev_profile_handler.sa_handler(sig);
+            return;
+         }
+         if (profile_buffer_size - s.size < max_profile_frames + 1) {
+            ++s.dropped;
+            return;
+         }
+#if defined(__x86_64__)
+         const mcontext_t& mc = static_cast<ucontext_t*>(uap)->uc_mcontext;
+         const uintptr_t ip = mc.gregs[REG_RIP];
+         const uintptr_t sp = mc.gregs[REG_RSP];
+         uintptr_t       fp = mc.gregs[REG_RBP];
+#else
+         const uintptr_t ip = 0, sp = 0;
+         uintptr_t       fp = 0;
+#endif
+         auto in_code = [&](uintptr_t addr) { return addr >= begin && addr < s.code_end; };
+         uintptr_t* header = s.buffer + s.size;
+         uintptr_t* frames = header + 1;
+         uintptr_t  host   = 0;
+         std::size_t n     = 0;
+         if (in_code(ip)) {
+            frames[n++] = ip;
+         } else if (s.host_ip) {
+            host        = uintptr_t(s.host_function) + 1;
+            frames[n++] = s.host_ip - 1;
+            fp          = s.host_fp;
+         } else {
+            fp = 0;
+         }
+         // Only frames between the interrupted stack pointer and stack_top are read, so a
+         // stale frame pointer cannot fault.
+         while (fp && n < max_profile_frames && fp >= sp && fp % alignof(uintptr_t) == 0 && fp + 2 * sizeof(uintptr_t) <= s.stack_top) {
+            const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+            if (!in_code(frame[1]))
+               break;
+            frames[n++] = frame[1] - 1; // inside the call instruction
+            if (frame[0] <= fp)
+               break;
+            fp = frame[0];
+         }
+         *header = n | (host << 32);
+         s.size += n + 1;
+      }
+
+      inline void setup_profile_signal_handler() {
+         static int init_helper = [] {
+            struct sigaction sa;
+            sa.sa_sigaction = &profile_signal_handler;
+            sigemptyset(&sa.sa_mask);
+            sa.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigaction(SIGPROF, &sa, &prev_profile_handler);
+            return 0;
+         }();
+         ignore_unused_variable_warning(init_helper);
+      }
+
+      // Per thread interval timer delivering SIGPROF to the owning thread.
+      class profile_timer {
+       public:
+         profile_timer() = default;
+         profile_timer(const profile_timer&) = delete;
+         profile_timer& operator=(const profile_timer&) = delete;
+         ~profile_timer() {
+            if (_created)
+               timer_delete(_id);
+         }
+
+         bool start(std::chrono::microseconds interval) {
+            if (!_created) {
+               struct sigevent sev = {};
+               sev.sigev_notify          = SIGEV_THREAD_ID;
+               sev.sigev_signo           = SIGPROF;
+#ifdef sigev_notify_thread_id
+               sev.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+#else
+               sev._sigev_un._tid         = static_cast<pid_t>(syscall(SYS_gettid));
+#endif
+               // a cpu clock would be more precise, but cpu timers only fire on scheduler ticks
+               if (timer_create(CLOCK_MONOTONIC, &sev, &_id) != 0)
+                  return false;
+               _created = true;
+            }
+            struct itimerspec its = {};
+            its.it_interval.tv_sec  = interval.count() / 1000000;
+            its.it_interval.tv_nsec = (interval.count() % 1000000) * 1000;
+            its.it_value            = its.it_interval;
+            return timer_settime(_id, 0, &its, nullptr) == 0;
+         }
+
+         void stop() {
+            struct itimerspec its = {};
+            timer_settime(_id, 0, &its, nullptr);
+         }
+
+         uintptr_t* buffer() {
+            if (!_buffer)
+               _buffer.reset(new uintptr_t[profile_buffer_size]);
+            return _buffer.get();
+         }
+
+       private:
+         timer_t                      _id;
+         bool                         _created = false;
+         std::unique_ptr<uintptr_t[]> _buffer;
+      };
+
+      inline thread_local profile_timer profile_thread_timer;
+
+      // Whether a profile_scope is sampling this thread.  Nothing else is written unless it is.
+      inline bool profiling() { return profile_state.code_begin != 0; }
+
+      // Records where the wasm frames of a jit call end, restoring the previous call on exit.
+      class profile_stack_guard {
+       public:
+         explicit profile_stack_guard(const void* stack_top) : _active(profiling()) {
+            if (!_active)
+               return;
+            _stack_top = profile_state.stack_top;
+            _host_ip   = profile_state.host_ip;
+            _host_fp   = profile_state.host_fp;
+            profile_state.stack_top = reinterpret_cast<uintptr_t>(stack_top);
+         }
+         ~profile_stack_guard() {
+            if (!_active)
+               return;
+            // also discards a host call that was left by longjmp
+            profile_state.host_ip   = _host_ip;
+            profile_state.host_fp   = _host_fp;
+            profile_state.stack_top = _stack_top;
+         }
+         profile_stack_guard(const profile_stack_guard&) = delete;
+         profile_stack_guard& operator=(const profile_stack_guard&) = delete;
+
+       private:
+         bool      _active;
+         uintptr_t _stack_top = 0;
+         uintptr_t _host_ip   = 0;
+         uintptr_t _host_fp   = 0;
+      };
+
+      // Called by the jit on entry to a host function while profiling().  caller_fp is the frame
+      // pointer of the calling wasm function.
+      inline void profile_enter_host(uint32_t function, uintptr_t caller_ip, uintptr_t caller_fp) {
+         profile_state.host_function = function;
+         profile_state.host_fp       = caller_fp;
+         std::atomic_signal_fence(std::memory_order_release);
+         profile_state.host_ip       = caller_ip;
+      }
+      inline void profile_exit_host() { profile_state.host_ip = 0; }
+   } // namespace detail
+
+   // Aggregated samples of one module.  Function addresses are kept relative to the code
+   // segment, so the data stays valid for any backend that compiled the same code.  Thread safe.
+   class profile_data {
+    public:
+      static constexpr uint32_t unknown_function = 0xFFFFFFFFu; // error handlers and the function table
+      static constexpr uint32_t native_code      = 0xFFFFFFFEu; // not in wasm or a host function
+
+      // layout of the code segment emitted by machine_code_writer, which asserts that these match
+      static constexpr std::size_t host_thunks_offset = 4 * 16;
+      static constexpr std::size_t host_thunk_size    = 40;
+
+      // mod must be compiled by the jit from wasm.  Function names are read from the "name" section
+      // of wasm here rather than by the parser, so that modules that are not profiled do not keep them.
+      profile_data(const module& mod, const wasm_code& wasm) {
+         const uint32_t num_imports = mod.get_imported_functions_size();
+         // The code segment starts with the error handlers and host call thunks, followed by the
+         // function table, which may be empty.  Function bodies come last and win ties when sorted.
+         _functions.emplace_back(0, unknown_function);
+         for (uint32_t i = 0; i < num_imports; ++i)
+            _functions.emplace_back(host_thunks_offset + host_thunk_size * i, i);
+         _functions.emplace_back(host_thunks_offset + host_thunk_size * num_imports, unknown_function);
+         for (uint32_t i = 0; i < mod.code.size(); ++i)
+            _functions.emplace_back(mod.code[i].jit_code_offset, i + num_imports);
+         std::stable_sort(_functions.begin(), _functions.end(),
+                          [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+         _names.reserve(mod.get_functions_total());
+         for (uint32_t i = 0; i < mod.imports.size(); ++i) {
+            if (mod.imports[i].kind != external_kind::Function)
+               continue;
+            const auto& imp = mod.imports[i];
+            std::string name(reinterpret_cast<const char*>(imp.module_str.raw()), imp.module_str.size());
+            name += '.';
+            name.append(reinterpret_cast<const char*>(imp.field_str.raw()), imp.field_str.size());
+            _names.push_back(sanitize(std::move(name)));
+         }
+         const auto function_names = read_function_names(wasm);
+         for (uint32_t i = num_imports; i < mod.get_functions_total(); ++i) {
+            auto it = function_names.find(i);
+            _names.push_back(it != function_names.end() ? sanitize(it->second) : "func[" + std::to_string(i) + "]");
+         }
+      }
+
+      // The function names subsection of the "name" custom section.  The contents of custom sections
+      // do not affect validation, so a malformed section yields no names.
+      static std::map<uint32_t, std::string> read_function_names(const wasm_code& wasm) {
+         std::map<uint32_t, std::string> result;
+         // only read through
+         wasm_code_ptr code(const_cast<uint8_t*>(wasm.data()), wasm.size());
+         try {
+            code += 8; // magic and version
+            while (code.offset() != wasm.size()) {
+               const uint8_t  id   = *code++;
+               const uint32_t len  = varuint<32>(code).to();
+               const std::size_t end = code.offset() + len;
+               auto section_guard  = code.scoped_shrink_bounds(len);
+               if (id == section_id::custom_section) {
+                  const uint32_t name_len = varuint<32>(code).to();
+                  const uint8_t* name     = code.raw();
+                  code += name_len;
+                  if (name_len == 4 && std::memcmp(name, "name", 4) == 0) {
+                     read_function_name_subsection(code, end, result);
+                     return result;
+                  }
+               }
+               code += end - code.offset();
+            }
+         } catch (const exception&) {
+            result.clear();
+         }
+         return result;
+      }
+
+      uint64_t samples() const {
+         std::lock_guard<std::mutex> g(_mutex);
+         return _samples;
+      }
+      uint64_t dropped() const {
+         std::lock_guard<std::mutex> g(_mutex);
+         return _dropped;
+      }
+
+      // One line per distinct stack: "root;outermost;...;leaf count"
+      void write_folded(std::ostream& os, std::string_view root) const {
+         std::lock_guard<std::mutex> g(_mutex);
+         for (const auto& [stack, count] : _stacks) {
+            os << root;
+            for (uint32_t fidx : stack)
+               os << ';' << name_of(fidx);
+            os << ' ' << count << '\n';
+         }
+      }
+
+      void clear() {
+         std::lock_guard<std::mutex> g(_mutex);
+         _stacks.clear();
+         _samples = _dropped = 0;
+      }
+
+      // Adds the raw samples collected by the signal handler for code starting at code_begin.
+      void add_samples(const uintptr_t* raw, std::size_t size, uint64_t dropped, uintptr_t code_begin) {
+         std::lock_guard<std::mutex> g(_mutex);
+         std::vector<uint32_t> stack;
+         for (std::size_t pos = 0; pos < size;) {
+            const uintptr_t header = raw[pos++];
+            const std::size_t n    = header & 0xFFFFFFFFu;
+            const uintptr_t host   = header >> 32;
+            stack.clear();
+            for (std::size_t i = n; i-- > 0;)
+               stack.push_back(function_at(raw[pos + i] - code_begin));
+            if (host)
+               stack.push_back(static_cast<uint32_t>(host - 1));
+            if (stack.empty())
+               stack.push_back(native_code);
+            ++_stacks[stack];
+            ++_samples;
+            pos += n;
+         }
+         _dropped += dropped;
+      }
+
+    private:
+      static void read_function_name_subsection(wasm_code_ptr& code, std::size_t end, std::map<uint32_t, std::string>& result) {
+         while (code.offset() != end) {
+            const uint8_t  id  = *code++;
+            const uint32_t len = varuint<32>(code).to();
+            auto subsection_guard = code.scoped_shrink_bounds(len);
+            if (id == 1) {
+               const uint32_t count = varuint<32>(code).to();
+               for (uint32_t i = 0; i < count; ++i) {
+                  const uint32_t fidx = varuint<32>(code).to();
+                  const uint32_t size = varuint<32>(code).to();
+                  const char*    name = reinterpret_cast<const char*>(code.raw());
+                  code += size;
+                  result[fidx].assign(name, size);
+               }
+               return;
+            }
+            code += len;
+         }
+      }
+
+      uint32_t function_at(std::size_t offset) const {
+         auto it = std::upper_bound(_functions.begin(), _functions.end(), offset,
+                                    [](std::size_t off, const auto& entry) { return off < entry.first; });
+         return it == _functions.begin() ? unknown_function : std::prev(it)->second;
+      }
+
+      std::string name_of(uint32_t fidx) const {
+         if (fidx == native_code)
+            return "[native]";
+         if (fidx >= _names.size())
+            return "[jit]";
+         return _names[fidx];
+      }
+
+      // ';' separates frames and the count follows the last space
+      static std::string sanitize(std::string name) {
+         for (char& c : name)
+            if (c == ';' || c == ' ' || c == '\n' || c == '\t')
+               c = '_';
+         return name;
+      }
+
+      mutable std::mutex                           _mutex;
+      std::vector<std::pair<std::size_t, uint32_t>> _functions; // sorted by code offset
+      std::vector<std::string>                     _names;
+      std::map<std::vector<uint32_t>, uint64_t>    _stacks;     // outermost frame first
+      uint64_t                                     _samples = 0;
+      uint64_t                                     _dropped = 0;
+   };
+
+   // Samples the calling thread while alive.  The code of mod must have been generated by the jit;
+   // scopes cannot be nested.
+   class profile_scope {
+    public:
+      static constexpr std::chrono::microseconds default_interval{100};
+
+      profile_scope(profile_data& data, const module& mod, std::chrono::microseconds interval = default_interval)
+         : _data(data) {
+         auto& s = detail::profile_state;
+         if (s.code_begin)
+            return;
+         detail::setup_profile_signal_handler();
+         s.buffer   = detail::profile_thread_timer.buffer();
+         s.size     = 0;
+         s.dropped  = 0;
+         s.code_end = reinterpret_cast<uintptr_t>(mod.allocator._code_base) + mod.allocator._code_size;
+         std::atomic_signal_fence(std::memory_order_release);
+         s.code_begin = reinterpret_cast<uintptr_t>(mod.allocator._code_base);
+         _active = detail::profile_thread_timer.start(interval);
+         if (!_active)
+            s.code_begin = 0;
+      }
+
+      ~profile_scope() {
+         if (!_active)
+            return;
+         auto& s = detail::profile_state;
+         detail::profile_thread_timer.stop();
+         const uintptr_t code_begin = s.code_begin;
+         s.code_begin = 0;
+         std::atomic_signal_fence(std::memory_order_seq_cst);
+         _data.add_samples(s.buffer, s.size, s.dropped, code_begin);
+      }
+
+      profile_scope(const profile_scope&) = delete;
+      profile_scope& operator=(const profile_scope&) = delete;
+
+    private:
+      profile_data& _data;
+      bool          _active = false;
+   };
+
+}} // namespace inery::vm
@@ -2,6 +2,7 @@
 
 #include <inery/vm/allocator.hpp>
 #include <inery/vm/exceptions.hpp>
+#include <inery/vm/profile.hpp>
 #include <inery/vm/signals.hpp>
 #include <inery/vm/softfloat.hpp>
 #include <inery/vm/types.hpp>
@@ -33,9 +34,14 @@ namespace inery { namespace vm {
    template<typename Context>
    class machine_code_writer {
     public:
+      static constexpr std::size_t error_handlers_size = 4 * 16; // 4 error handlers, each is 16 bytes.
+      static constexpr std::size_t host_call_size      = 40;     // counted manually, see emit_host_call
+      static_assert(profile_data::host_thunks_offset == error_handlers_size && profile_data::host_thunk_size == host_call_size,
+                    "profile_data must match the layout of the code segment");
+
       machine_code_writer(growable_allocator& alloc, std::size_t source_bytes, module& mod) :
          _mod(mod), _code_segment_base(alloc.start_code()) {
-         const std::size_t code_size = 4 * 16; // 4 error handlers, each is 16 bytes.
+         const std::size_t code_size = error_handlers_size;
          _code_start = _mod.allocator.alloc<unsigned char>(code_size);
          _code_end = _code_start + code_size;
          code = _code_start;
@@ -50,7 +56,7 @@ namespace inery { namespace vm {
 
          // emit host functions
          const uint32_t num_imported = mod.get_imported_functions_size();
-         const std::size_t host_functions_size = 40 * num_imported;
+         const std::size_t host_functions_size = host_call_size * num_imported;
          _code_start = _mod.allocator.alloc<unsigned char>(host_functions_size);
          _code_end = _code_start + host_functions_size;
          // code already set
@@ -2601,12 +2607,20 @@ namespace inery { namespace vm {
       bool is_host_function(uint32_t funcnum) { return funcnum < _mod.get_imported_functions_size(); }
 
       static native_value call_host_function(Context* context /*rdi*/, native_value* stack /*rsi*/, uint32_t idx /*edx*/) {
+         // The thunk does not touch rbp, so the frame pointer saved by this function is
+         // the one of the calling wasm function.  The return address is below the arguments.
+         const bool profiling = detail::profiling();
+         if (profiling)
+            detail::profile_enter_host(idx, static_cast<uintptr_t>(stack[-1].i64),
+                                       *static_cast<uintptr_t*>(__builtin_frame_address(0)));
          // It's currently unsafe to throw through a jit frame, because we don't set up
          // the exception tables for them.
          native_value result;
          vm::longjmp_on_exception([&]() {
             result = context->call_host_function(stack, idx);
          });
+         if (profiling)
+            detail::profile_exit_host();
          return result;
       }
 
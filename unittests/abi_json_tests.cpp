@@ -0,0 +1,101 @@
+#include "abi_test_utils.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+using namespace abi_test;
+
+namespace {
+
+std::string via_variant( const abi_serializer& abis, const bytes& bin, fc::json::output_formatting format ) {
+   return fc::json::to_string( abis.binary_to_variant( "numbers", bin, yield() ), fc::time_point::maximum(), format );
+}
+
+std::string streamed( const abi_serializer& abis, const bytes& bin, fc::json::output_formatting format ) {
+   std::string out;
+   abis.binary_to_json( "numbers", bin, out, yield(), {}, false, format );
+   return out;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(abi_json_tests)
+
+// large integers are quoted exactly where fc::json quotes them
+BOOST_AUTO_TEST_CASE( matches_fc_json_at_integer_boundaries ) try {
+   const auto abis = make_serializer();
+   const std::vector<std::string> int64s = {
+      "0", "-1", "2147483647", "2147483648", "-2147483648", "-2147483649",
+      "4294967295", "4294967296", "-4294967295", "-4294967296",
+      "9223372036854775807", "-9223372036854775808" };
+   const std::vector<std::string> uint64s = { "0", "4294967295", "4294967296", "18446744073709551615" };
+
+   for( auto format : { fc::json::output_formatting::stringify_large_ints_and_doubles, fc::json::output_formatting::legacy_generator } ) {
+      for( const auto& i : int64s ) {
+         for( const auto& u : uint64s ) {
+            const bytes bin = pack( *abis, numbers_json( i, u, "-2147483648", "4294967295" ) );
+            BOOST_TEST_CONTEXT( "int64 " << i << ", uint64 " << u ) {
+               BOOST_CHECK_EQUAL( streamed( *abis, bin, format ), via_variant( *abis, bin, format ) );
+            }
+         }
+      }
+   }
+
+   // absent optional and binary extension
+   bytes bin = pack( *abis, "{\"owner\":\"bob\",\"i64\":1,\"u64\":2,\"i32\":3,\"u32\":4,\"f64\":0,\"list\":[],\"maybe\":null,"
+                           "\"choice\":[\"string\",\"x\"],\"stamp\":\"2020-01-01T00:00:00\",\"text\":\"\",\"data\":\"\",\"more\":5}" );
+   BOOST_CHECK_EQUAL( streamed( *abis, bin, fc::json::output_formatting::stringify_large_ints_and_doubles ),
+                      via_variant( *abis, bin, fc::json::output_formatting::stringify_large_ints_and_doubles ) );
+} FC_LOG_AND_RETHROW()
+
+// the output yield sees the size of the JSON as it grows, and can stop it
+BOOST_AUTO_TEST_CASE( output_yield ) try {
+   const auto abis = make_serializer();
+   const bytes bin = pack( *abis, numbers_json( "1", "2" ) );
+
+   std::string out = "prefix";
+   size_t calls = 0, last = 0;
+   abis->binary_to_json( "numbers", bin, out, yield(), [&]( size_t size ) {
+      BOOST_CHECK_GE( size, last );
+      last = size;
+      ++calls;
+   } );
+   BOOST_CHECK_GT( calls, 10u );
+   BOOST_CHECK_LT( last, out.size() - 6 );
+
+   const size_t max_size = 20;
+   std::string limited;
+   BOOST_CHECK_THROW( abis->binary_to_json( "numbers", bin, limited, yield(), [&]( size_t size ) { FC_ASSERT( size <= max_size ); } ),
+                      fc::assert_exception );
+} FC_LOG_AND_RETHROW()
+
+// a derived struct repeating a field of its base is written as binary_to_variant writes it, in arrays too
+BOOST_AUTO_TEST_CASE( duplicate_fields ) try {
+   const auto abis = make_serializer( make_abi( R"=====(
+   {
+      "version": "inery::abi/1.1",
+      "structs": [
+         { "name": "base", "base": "", "fields": [ { "name": "owner", "type": "name" }, { "name": "amount", "type": "uint64" } ] },
+         { "name": "derived", "base": "base", "fields": [ { "name": "memo", "type": "string" }, { "name": "amount", "type": "string" } ] },
+         { "name": "holder", "base": "", "fields": [ { "name": "items", "type": "derived[]" }, { "name": "plain", "type": "base" } ] }
+      ]
+   }
+   )=====" ) );
+   bytes bin;
+   const auto append = [&]( const auto& v ) {
+      const bytes b = fc::raw::pack( v );
+      bin.insert( bin.end(), b.begin(), b.end() );
+   };
+   append( unsigned_int( 3 ) );
+   for( const char* amount : { "1", "two", "" } ) {
+      append( N(alice) ); append( uint64_t( 7 ) ); append( std::string( "memo" ) ); append( std::string( amount ) );
+   }
+   append( N(bob) ); append( uint64_t( 8 ) );
+
+   std::string out;
+   abis->binary_to_json( "holder", bin, out, yield(), {} );
+   BOOST_CHECK_EQUAL( out, fc::json::to_string( abis->binary_to_variant( "holder", bin, yield() ), fc::time_point::maximum() ) );
+   BOOST_CHECK_NE( out.find( "\"amount\":\"two\"" ), std::string::npos );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
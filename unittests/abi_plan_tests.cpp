@@ -0,0 +1,76 @@
+#include <inery/chain/abi_plan.hpp>
+
+#include "abi_test_utils.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+using namespace abi_test;
+
+namespace {
+
+template<typename Converter>
+std::string to_json( const Converter& c, const bytes& bin, fc::json::output_formatting format = fc::json::output_formatting::stringify_large_ints_and_doubles ) {
+   std::string out;
+   c.binary_to_json( "numbers", bin, out, yield(), {}, false, format );
+   return out;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(abi_plan_tests)
+
+BOOST_AUTO_TEST_CASE( matches_serializer ) try {
+   const auto abis = make_serializer();
+   const abi_plan plan( abis ), delegating( abis, false );
+   const std::vector<std::pair<std::string, std::string>> values = {
+      { "0", "0" }, { "4294967295", "4294967295" }, { "4294967296", "4294967296" }, { "-4294967295", "1" },
+      { "-4294967296", "18446744073709551615" }, { "-9223372036854775808", "2" }, { "9223372036854775807", "3" } };
+
+   for( auto format : { fc::json::output_formatting::stringify_large_ints_and_doubles, fc::json::output_formatting::legacy_generator } ) {
+      for( const auto& [i64, u64] : values ) {
+         const bytes bin = pack( *abis, numbers_json( i64, u64 ) );
+         const std::string expected = to_json( *abis, bin, format );
+         BOOST_CHECK_EQUAL( to_json( plan, bin, format ), expected );
+         BOOST_CHECK_EQUAL( to_json( delegating, bin, format ), expected );
+      }
+   }
+} FC_LOG_AND_RETHROW()
+
+// invalid input is decoded again by the serializer, which reports the error
+BOOST_AUTO_TEST_CASE( errors_come_from_serializer ) try {
+   const auto abis = make_serializer();
+   const abi_plan plan( abis );
+   bytes bin = pack( *abis, numbers_json( "1", "2" ) );
+   bin.resize( bin.size() - 1 );
+
+   std::string out = "kept";
+   BOOST_CHECK_THROW( plan.binary_to_json( "numbers", bin, out, yield(), {} ),
+                      unpack_exception );
+} FC_LOG_AND_RETHROW()
+
+// a deadline is not retried by the serializer
+BOOST_AUTO_TEST_CASE( deadline_is_not_retried ) try {
+   const auto abis = make_serializer();
+   const abi_plan plan( abis );
+   const bytes bin = pack( *abis, numbers_json( "1", "2" ) );
+
+   size_t calls = 0;
+   const abi_serializer::yield_function_t expire_once = [&]( size_t ) {
+      INE_ASSERT( calls++ != 0, abi_serialization_deadline_exception, "serialization time limit exceeded" );
+   };
+   std::string out;
+   BOOST_CHECK_THROW( plan.binary_to_json( "numbers", bin, out, expire_once, {} ), abi_serialization_deadline_exception );
+   BOOST_CHECK_EQUAL( calls, 1u );
+
+   calls = 0;
+   const fc::json::yield_function_t output_expires_once = [&]( size_t ) {
+      if( calls++ == 0 )
+         FC_THROW_EXCEPTION( fc::timeout_exception, "output deadline" );
+   };
+   BOOST_CHECK_THROW( plan.binary_to_json( "numbers", bin, out, yield(), output_expires_once ),
+                      fc::timeout_exception );
+   BOOST_CHECK_EQUAL( calls, 1u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
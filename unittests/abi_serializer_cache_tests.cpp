@@ -0,0 +1,96 @@
+#include <inery/chain/abi_serializer_cache.hpp>
+
+#include "abi_test_utils.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+using namespace abi_test;
+
+namespace {
+
+const chain_id_type chain_id( fc::sha256::hash( std::string( "test chain" ) ).str() );
+
+std::string_view view( const bytes& b ) {
+   return std::string_view( b.data(), b.size() );
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(abi_serializer_cache_tests)
+
+BOOST_AUTO_TEST_CASE( compares_abi ) try {
+   abi_serializer_cache cache( 2 );
+   const abi_def abi1 = make_abi( transfer_abi );
+   abi_def abi2 = abi1;
+   abi2.structs[0].fields[0].name = "ownex";
+   const bytes packed1 = fc::raw::pack( abi1 ), packed2 = fc::raw::pack( abi2 );
+
+   const auto abis1 = cache.get( chain_id, N(alice), 1, view( packed1 ), yield() );
+   BOOST_REQUIRE( abis1 );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed1 ), yield() ) == abis1 );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 2, view( packed1 ), yield() ) != abis1 );
+
+   // same abi_sequence, other ABI of the same size: a setabi that was rolled back
+   const auto abis2 = cache.get( chain_id, N(alice), 1, view( packed2 ), yield() );
+   BOOST_REQUIRE( abis2 );
+   BOOST_CHECK( abis2 != abis1 );
+   BOOST_CHECK_EQUAL( abis2->get_struct( "transfer" ).fields[0].name, "ownex" );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed2 ), yield() ) == abis2 );
+
+   // no ABI
+   BOOST_CHECK( !cache.get( chain_id, N(bob), 1, std::string_view(), yield() ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( chains_are_kept_apart ) try {
+   abi_serializer_cache cache( 2 );
+   const chain_id_type other_chain( fc::sha256::hash( std::string( "other chain" ) ).str() );
+   const bytes packed = fc::raw::pack( make_abi( transfer_abi ) );
+
+   const auto abis = cache.get( chain_id, N(alice), 1, view( packed ), yield() );
+   const auto other = cache.get( other_chain, N(alice), 1, view( packed ), yield() );
+   BOOST_REQUIRE( abis && other );
+   BOOST_CHECK( abis != other );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed ), yield() ) == abis );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( least_recently_used_is_dropped ) try {
+   abi_serializer_cache cache( 2 );
+   const bytes packed = fc::raw::pack( make_abi( transfer_abi ) );
+
+   const auto alice = cache.get( chain_id, N(alice), 1, view( packed ), yield() );
+   const auto bob   = cache.get( chain_id, N(bob), 1, view( packed ), yield() );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed ), yield() ) == alice );
+   cache.get( chain_id, N(carol), 1, view( packed ), yield() );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed ), yield() ) == alice );
+   BOOST_CHECK( cache.get( chain_id, N(bob), 1, view( packed ), yield() ) != bob );
+
+   cache.clear();
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+} FC_LOG_AND_RETHROW()
+
+// the plan lives in the entry of its serializer
+BOOST_AUTO_TEST_CASE( plan_shares_the_entry ) try {
+   abi_serializer_cache cache( 2 );
+   const bytes packed = fc::raw::pack( make_abi( transfer_abi ) );
+
+   const auto plan = cache.get_plan( chain_id, N(alice), 1, view( packed ), yield() );
+   BOOST_REQUIRE( plan );
+   BOOST_CHECK_EQUAL( cache.size(), 1u );
+   BOOST_CHECK( cache.get( chain_id, N(alice), 1, view( packed ), yield() ).get() == &plan->serializer() );
+   BOOST_CHECK( cache.get_plan( chain_id, N(alice), 1, view( packed ), yield() ) == plan );
+
+   // a serializer cached first gets its plan added
+   const auto abis = cache.get( chain_id, N(bob), 1, view( packed ), yield() );
+   const auto bob_plan = cache.get_plan( chain_id, N(bob), 1, view( packed ), yield() );
+   BOOST_REQUIRE( bob_plan );
+   BOOST_CHECK( &bob_plan->serializer() == abis.get() );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+
+   BOOST_CHECK( !cache.get_plan( chain_id, N(carol), 1, std::string_view(), yield() ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
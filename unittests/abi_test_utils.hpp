@@ -0,0 +1,76 @@
+#pragma once
+
+#include <inery/chain/abi_serializer.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <memory>
+#include <string>
+
+// Scaffolding shared by the abi_serializer test files
+namespace abi_test {
+
+using namespace inery::chain;
+
+inline const fc::microseconds max_serialization_time = fc::seconds( 1 );
+
+inline abi_serializer::yield_function_t yield() {
+   return abi_serializer::create_yield_function( max_serialization_time );
+}
+
+// "numbers" covers integer quoting, aliases, optionals, variants, escaping and binary extensions
+inline const char* numbers_abi = R"=====(
+{
+   "version": "inery::abi/1.1",
+   "types": [ { "new_type_name": "amounts", "type": "int64[]" } ],
+   "structs": [
+      { "name": "base", "base": "", "fields": [ { "name": "owner", "type": "name" } ] },
+      { "name": "numbers", "base": "base", "fields": [
+         { "name": "i64", "type": "int64" },
+         { "name": "u64", "type": "uint64" },
+         { "name": "i32", "type": "int32" },
+         { "name": "u32", "type": "uint32" },
+         { "name": "f64", "type": "float64" },
+         { "name": "list", "type": "amounts" },
+         { "name": "maybe", "type": "uint64?" },
+         { "name": "choice", "type": "number_or_text" },
+         { "name": "stamp", "type": "time_point_sec" },
+         { "name": "text", "type": "string" },
+         { "name": "data", "type": "bytes" },
+         { "name": "more", "type": "uint64$" }
+      ] }
+   ],
+   "variants": [ { "name": "number_or_text", "types": [ "int64", "string" ] } ]
+}
+)=====";
+
+// a contract with a single "transfer" action
+inline const char* transfer_abi = R"=====(
+{
+   "version": "inery::abi/1.1",
+   "structs": [ { "name": "transfer", "base": "", "fields": [ { "name": "owner", "type": "name" }, { "name": "amount", "type": "uint64" } ] } ],
+   "actions": [ { "name": "transfer", "type": "transfer", "ricardian_contract": "" } ]
+}
+)=====";
+
+inline abi_def make_abi( const char* json = numbers_abi ) {
+   return fc::json::from_string( json ).as<abi_def>();
+}
+
+inline std::shared_ptr<const abi_serializer> make_serializer( const abi_def& abi = make_abi() ) {
+   return std::make_shared<const abi_serializer>( abi, yield() );
+}
+
+/// a "numbers" struct from JSON
+inline bytes pack( const abi_serializer& abis, const std::string& json ) {
+   return abis.variant_to_binary( "numbers", fc::json::from_string( json ), yield() );
+}
+
+/// a "numbers" struct in JSON; the 64 bit integers are given as strings so that they survive fc::json
+inline std::string numbers_json( const std::string& i64, const std::string& u64, const std::string& i32 = "0", const std::string& u32 = "0" ) {
+   return "{\"owner\":\"alice\",\"i64\":\"" + i64 + "\",\"u64\":\"" + u64 + "\",\"i32\":" + i32 + ",\"u32\":" + u32 +
+          ",\"f64\":1.5,\"list\":[\"" + i64 + "\",\"0\"],\"maybe\":\"" + u64 + "\",\"choice\":[\"int64\",\"" + i64 + "\"]" +
+          ",\"stamp\":\"2020-01-01T00:00:00\",\"text\":\"a \\\"quoted\\\"\\n\\u0001 text\",\"data\":\"00ff\"}";
+}
+
+} // namespace abi_test
@@ -0,0 +1,70 @@
+#include "abi_test_utils.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+using namespace abi_test;
+
+namespace {
+
+struct transfer {
+   name     owner;
+   uint64_t amount = 0;
+};
+
+std::vector<std::string> keys( const fc::variant& v ) {
+   std::vector<std::string> result;
+   for( const auto& e : v.get_object() )
+      result.push_back( e.key() );
+   return result;
+}
+
+} // anonymous namespace
+
+FC_REFLECT( transfer, (owner)(amount) )
+
+BOOST_AUTO_TEST_SUITE(abi_to_variant_tests)
+
+// the objects are reserved for exactly these keys
+BOOST_AUTO_TEST_CASE( keys_of_hand_written_overloads ) try {
+   const auto yield = abi_serializer::create_yield_function( max_serialization_time );
+   const auto abis = make_serializer( make_abi( transfer_abi ) );
+   auto resolver = [&]( const account_name& n ) -> const abi_serializer* { return n == N(token) ? abis.get() : nullptr; };
+
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{ { N(alice), config::active_name } }, N(token), N(transfer),
+                             fc::raw::pack( transfer{ N(alice), 42 } ) );
+   trx.actions.emplace_back( vector<permission_level>{}, N(other), N(transfer), bytes{ 1, 2 } );
+
+   fc::variant v;
+   abi_serializer::to_variant( trx.actions[0], v, resolver, yield );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "account", "name", "authorization", "data", "hex_data" }) );
+   BOOST_CHECK_EQUAL( v["data"]["amount"].as_uint64(), 42u );
+   abi_serializer::to_variant( trx.actions[1], v, resolver, yield );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "account", "name", "authorization", "data" }) );
+
+   abi_serializer::to_variant( static_cast<const transaction&>( trx ), v, resolver, yield );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "expiration", "ref_block_num", "ref_block_prefix", "max_net_usage_words",
+                                                       "max_cpu_usage_ms", "delay_sec", "context_free_actions", "actions" }) );
+
+   abi_serializer::to_variant( packed_transaction( trx ), v, resolver, yield );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "id", "signatures", "compression", "packed_context_free_data",
+                                                       "context_free_data", "packed_trx", "transaction" }) );
+   BOOST_CHECK_EQUAL( v["transaction"]["actions"][size_t( 0 )]["data"]["owner"].as_string(), "alice" );
+} FC_LOG_AND_RETHROW()
+
+// reflected types are reserved for all their members; absent optionals are still left out
+BOOST_AUTO_TEST_CASE( reflected_members ) try {
+   const auto yield = abi_serializer::create_yield_function( max_serialization_time );
+   auto resolver = []( const account_name& ) -> const abi_serializer* { return nullptr; };
+
+   fc::variant v;
+   abi_serializer::to_variant( permission_level{ N(alice), config::active_name }, v, resolver, yield );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "actor", "permission" }) );
+
+   fc::to_variant( transfer{ N(bob), 7 }, v );
+   BOOST_CHECK( keys( v ) == std::vector<std::string>({ "owner", "amount" }) );
+   BOOST_CHECK_EQUAL( v["amount"].as_uint64(), 7u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
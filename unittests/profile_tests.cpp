@@ -0,0 +1,106 @@
+#include <fc/exception/exception.hpp>
+
+#include <inery/vm/backend.hpp>
+#include <inery/vm/profile.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace inery::vm;
+
+namespace {
+
+struct profile_host {};
+using rhf_t = registered_host_functions<profile_host>;
+
+// state of the profiler as seen from inside a host function
+bool host_call_recorded = false;
+bool stack_recorded     = false;
+
+void probe() {
+   host_call_recorded = detail::profile_state.host_ip != 0;
+   stack_recorded     = detail::profile_state.stack_top != 0;
+}
+
+registered_function<profile_host, std::nullptr_t, &probe> probe_fn( "env", "probe" );
+
+// (module
+//   (import "env" "probe" (func $probe))
+//   (func $spin (export "spin") (param i32) (loop local.get 0 i32.const 1 i32.sub local.tee 0 br_if 0))
+//   (func (export "probe") call $probe))
+std::vector<uint8_t> profile_wasm = {
+   0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+   0x01, 0x08, 0x02, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7f, 0x00,
+   0x02, 0x0d, 0x01, 0x03, 0x65, 0x6e, 0x76, 0x05, 0x70, 0x72, 0x6f, 0x62, 0x65, 0x00, 0x00,
+   0x03, 0x03, 0x02, 0x01, 0x00,
+   0x07, 0x10, 0x02,
+      0x04, 0x73, 0x70, 0x69, 0x6e, 0x00, 0x01,
+      0x05, 0x70, 0x72, 0x6f, 0x62, 0x65, 0x00, 0x02,
+   0x0a, 0x15, 0x02,
+      0x0e, 0x00, 0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x22, 0x00, 0x0d, 0x00, 0x0b, 0x0b,
+      0x04, 0x00, 0x10, 0x00, 0x0b,
+   0x00, 0x0e, 0x04, 0x6e, 0x61, 0x6d, 0x65, 0x01, 0x07, 0x01, 0x01, 0x04, 0x73, 0x70, 0x69, 0x6e };
+
+struct profiled_module {
+   profiled_module() {
+      rhf_t::resolve( bkend.get_module() );
+      bkend.set_wasm_allocator( &wa );
+      bkend.initialize( nullptr );
+   }
+
+   backend<profile_host, jit> bkend{ profile_wasm };
+   wasm_allocator             wa;
+   profile_host               host;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(profile_tests)
+
+BOOST_AUTO_TEST_CASE( samples_named_functions ) try {
+   profiled_module m;
+   profile_data data( m.bkend.get_module(), profile_wasm );
+   {
+      profile_scope scope( data, m.bkend.get_module() );
+      BOOST_REQUIRE( detail::profiling() );
+      for( int i = 0; i < 4; ++i )
+         m.bkend.call( &m.host, "env", "spin", uint32_t( 1 ) << 24 );
+      // samples are collected when the scope ends
+      BOOST_CHECK_EQUAL( data.samples(), 0u );
+   }
+   BOOST_CHECK( !detail::profiling() );
+   BOOST_REQUIRE_GT( data.samples(), 0u );
+
+   std::ostringstream folded;
+   data.write_folded( folded, "root" );
+   BOOST_CHECK( folded.str().find( "root;spin " ) != std::string::npos );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( function_names_from_name_section ) try {
+   BOOST_CHECK( profile_data::read_function_names( profile_wasm ) == ( std::map<uint32_t, std::string>{ { 1, "spin" } } ) );
+   // a truncated name section is ignored
+   const wasm_code truncated( profile_wasm.begin(), profile_wasm.end() - 1 );
+   BOOST_CHECK( profile_data::read_function_names( truncated ).empty() );
+} FC_LOG_AND_RETHROW()
+
+// host calls only touch the profiler state of the thread while it is sampled
+BOOST_AUTO_TEST_CASE( host_calls_recorded_only_while_profiling ) try {
+   profiled_module m;
+
+   m.bkend.call( &m.host, "env", "probe" );
+   BOOST_CHECK( !host_call_recorded );
+   BOOST_CHECK( !stack_recorded );
+
+   profile_data data( m.bkend.get_module(), profile_wasm );
+   {
+      profile_scope scope( data, m.bkend.get_module() );
+      m.bkend.call( &m.host, "env", "probe" );
+      BOOST_CHECK( host_call_recorded );
+      BOOST_CHECK( stack_recorded );
+   }
+   BOOST_CHECK_EQUAL( detail::profile_state.host_ip, 0u );
+   BOOST_CHECK_EQUAL( detail::profile_state.stack_top, 0u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
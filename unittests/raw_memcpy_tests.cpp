@@ -0,0 +1,133 @@
+#include <fc/io/raw.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+
+using namespace fc;
+
+namespace {
+
+struct in_order {
+   uint64_t a = 0;
+   uint32_t b = 0;
+   int16_t  c = 0;
+   std::array<uint8_t, 2> d = {};
+};
+
+struct reordered {
+   uint32_t x = 0;
+   uint32_t y = 0;
+};
+
+struct nested {
+   in_order inner;
+   uint64_t tail = 0;
+};
+
+struct padded {
+   uint8_t  a = 0;
+   uint32_t b = 0;
+};
+
+struct with_bool {
+   bool    flag = false;
+   std::array<uint8_t, 7> pad = {};
+};
+
+struct with_hash {
+   fc::sha256 id;
+   uint64_t   n = 0;
+};
+
+/// the bytes packing each reflected member of v on its own
+template<typename T>
+std::vector<char> pack_members( const T& v ) {
+   std::vector<char> result;
+   datastream<std::vector<char>> ds( result );
+   fc::reflector<T>::visit( raw::detail::pack_object_visitor<datastream<std::vector<char>>, T>( v, ds ) );
+   return result;
+}
+
+} // anonymous namespace
+
+FC_REFLECT( in_order, (a)(b)(c)(d) )
+FC_REFLECT( reordered, (y)(x) )
+FC_REFLECT( nested, (inner)(tail) )
+FC_REFLECT( padded, (a)(b) )
+FC_REFLECT( with_bool, (flag)(pad) )
+FC_REFLECT( with_hash, (id)(n) )
+
+BOOST_AUTO_TEST_SUITE(raw_memcpy_tests)
+
+BOOST_AUTO_TEST_CASE( which_types_qualify ) try {
+   static_assert( raw::detail::is_memcpy_packable<in_order>() );
+   static_assert( raw::detail::is_memcpy_packable<nested>() );
+   static_assert( raw::detail::is_memcpy_packable<reordered>() );
+   static_assert( raw::detail::is_memcpy_packable<with_hash>() );
+   static_assert( !raw::detail::is_memcpy_packable<padded>() );
+   static_assert( !raw::detail::is_memcpy_packable<with_bool>() );
+
+   BOOST_CHECK( raw::detail::has_memcpy_layout<in_order>() );
+   BOOST_CHECK( raw::detail::has_memcpy_layout<nested>() );
+   BOOST_CHECK( raw::detail::has_memcpy_layout<with_hash>() );
+   // reflected in another order than declared
+   BOOST_CHECK( !raw::detail::has_memcpy_layout<reordered>() );
+} FC_LOG_AND_RETHROW()
+
+// the copied bytes are exactly those of packing member by member
+BOOST_AUTO_TEST_CASE( same_bytes_as_member_wise ) try {
+   const nested n{ { 0x0102030405060708ull, 0x090a0b0c, -2, { 0xfe, 0x7f } }, 42 };
+   BOOST_CHECK( raw::pack( n ) == pack_members( n ) );
+   BOOST_CHECK_EQUAL( raw::pack_size( n ), sizeof( n ) );
+
+   const reordered r{ 1, 2 };
+   const std::vector<char> packed_r = raw::pack( r );
+   BOOST_CHECK( packed_r == pack_members( r ) );
+   BOOST_CHECK_EQUAL( raw::unpack<uint32_t>( packed_r ), 2u );
+
+   const padded p{ 1, 2 };
+   BOOST_CHECK_EQUAL( raw::pack( p ).size(), 5u );
+
+   const auto u = raw::unpack<nested>( raw::pack( n ) );
+   BOOST_CHECK_EQUAL( u.inner.a, n.inner.a );
+   BOOST_CHECK_EQUAL( u.inner.c, n.inner.c );
+   BOOST_CHECK_EQUAL( u.inner.d[1], n.inner.d[1] );
+   BOOST_CHECK_EQUAL( u.tail, n.tail );
+   const auto ur = raw::unpack<reordered>( packed_r );
+   BOOST_CHECK_EQUAL( ur.x, 1u );
+   BOOST_CHECK_EQUAL( ur.y, 2u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( vectors ) try {
+   std::vector<in_order> v;
+   for( uint32_t i = 0; i < 5; ++i )
+      v.push_back( in_order{ i, i * 3, int16_t( -i ), { uint8_t( i ), 0 } } );
+
+   std::vector<char> expected = raw::pack( unsigned_int( v.size() ) );
+   for( const auto& e : v ) {
+      const auto packed = pack_members( e );
+      expected.insert( expected.end(), packed.begin(), packed.end() );
+   }
+   const std::vector<char> packed = raw::pack( v );
+   BOOST_CHECK( packed == expected );
+
+   const auto u = raw::unpack<std::vector<in_order>>( packed );
+   BOOST_REQUIRE_EQUAL( u.size(), v.size() );
+   for( size_t i = 0; i < v.size(); ++i ) {
+      BOOST_CHECK_EQUAL( u[i].a, v[i].a );
+      BOOST_CHECK_EQUAL( u[i].b, v[i].b );
+      BOOST_CHECK_EQUAL( u[i].c, v[i].c );
+   }
+
+   // a count beyond the input is rejected before anything is allocated for it
+   const std::vector<char> truncated( packed.begin(), packed.end() - 1 );
+   std::vector<in_order> out;
+   datastream<const char*> ds( truncated.data(), truncated.size() );
+   BOOST_CHECK_THROW( raw::unpack( ds, out ), fc::out_of_range_exception );
+   BOOST_CHECK( out.empty() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
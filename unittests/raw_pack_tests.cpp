@@ -0,0 +1,106 @@
+#include <fc/io/datastream.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+/// counts how often it is packed; packs its text through a nested fc::raw::pack
+struct counted {
+   std::string text;
+};
+
+size_t times_packed = 0;
+
+} // anonymous namespace
+
+FC_REFLECT( counted, (text) )
+
+// declared ahead of fc/io/raw.hpp, like the overloads in raw_fwd.hpp, so that its templates find them
+namespace fc { namespace raw {
+   template<typename Stream> void pack( Stream& s, const counted& c );
+   template<typename Stream> void unpack( Stream& s, counted& c );
+} }
+
+#include <fc/io/raw.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace fc { namespace raw {
+   template<typename Stream> void pack( Stream& s, const counted& c ) {
+      ++times_packed;
+      const std::vector<char> text = fc::raw::pack( c.text );
+      s.write( text.data(), text.size() );
+   }
+   template<typename Stream> void unpack( Stream& s, counted& c ) {
+      fc::raw::unpack( s, c.text );
+   }
+} }
+
+using namespace fc;
+
+namespace {
+
+/// packed the way pack() did before: sized by a first pass, written by a second
+template<typename T>
+std::vector<char> pack_two_pass( const T& v ) {
+   std::vector<char> result( raw::pack_size( v ) );
+   datastream<char*> ds( result.data(), result.size() );
+   raw::pack( ds, v );
+   return result;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(raw_pack_tests)
+
+BOOST_AUTO_TEST_CASE( one_pass ) try {
+   const std::vector<counted> values = { { "a" }, { std::string( 1000, 'b' ) }, { "" } };
+
+   times_packed = 0;
+   const std::vector<char> packed = raw::pack( values );
+   BOOST_CHECK_EQUAL( times_packed, values.size() );
+
+   BOOST_CHECK( packed == pack_two_pass( values ) );
+   const auto unpacked = raw::unpack<std::vector<counted>>( packed );
+   BOOST_REQUIRE_EQUAL( unpacked.size(), values.size() );
+   for( size_t i = 0; i < values.size(); ++i )
+      BOOST_CHECK_EQUAL( unpacked[i].text, values[i].text );
+
+   // several values in one call
+   const std::vector<char> both = raw::pack( uint32_t( 7 ), values );
+   BOOST_CHECK_EQUAL( both.size(), sizeof( uint32_t ) + packed.size() );
+   BOOST_CHECK( std::equal( packed.begin(), packed.end(), both.begin() + sizeof( uint32_t ) ) );
+} FC_LOG_AND_RETHROW()
+
+// the buffer of the thread is reused, also after it grew beyond what it keeps
+BOOST_AUTO_TEST_CASE( buffer_reuse ) try {
+   const std::string large( raw::detail::max_retained_pack_buffer_size + 1, 'x' );
+   const std::vector<char> large_packed = raw::pack( large );
+   BOOST_CHECK( large_packed == pack_two_pass( large ) );
+
+   const std::vector<char> small_packed = raw::pack( std::string( "small" ) );
+   BOOST_CHECK_EQUAL( small_packed.size(), 6u );
+   BOOST_CHECK_EQUAL( raw::unpack<std::string>( small_packed ), "small" );
+   BOOST_CHECK_EQUAL( raw::unpack<std::string>( raw::pack( large ) ).size(), large.size() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( pack_into_exact_size ) try {
+   const std::vector<std::string> v = { "one", "two", std::string( 100, 'z' ) };
+   std::vector<char> out( 1000, 'q' );
+   raw::pack_into( out, v );
+   BOOST_CHECK( out == pack_two_pass( v ) );
+
+   std::string str;
+   str.reserve( 4 );
+   raw::pack_into( str, v );
+   BOOST_CHECK_EQUAL( str.size(), out.size() );
+   BOOST_CHECK( std::equal( str.begin(), str.end(), out.begin() ) );
+
+   raw::pack_into( out, std::vector<std::string>() );
+   BOOST_CHECK_EQUAL( out.size(), 1u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,62 @@
+#include <fc/io/raw.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace fc;
+
+namespace {
+
+/// a packed string whose length prefix claims claimed bytes, followed by only present of them
+std::vector<char> truncated( uint32_t claimed, uint32_t present ) {
+   std::vector<char> result = raw::pack( unsigned_int( claimed ) );
+   result.insert( result.end(), present, 'x' );
+   return result;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(raw_string_tests)
+
+BOOST_AUTO_TEST_CASE( string_round_trip ) try {
+   for( const std::string& s : { std::string(), std::string( "name" ), std::string( 300, 'a' ) } ) {
+      const std::vector<char> packed = raw::pack( s );
+      BOOST_CHECK( raw::pack( std::string_view( s ) ) == packed );
+
+      std::string str = "previous";
+      datastream<const char*> ds( packed.data(), packed.size() );
+      raw::unpack( ds, str );
+      BOOST_CHECK_EQUAL( str, s );
+      BOOST_CHECK_EQUAL( ds.remaining(), 0u );
+
+      // a view into the packed buffer
+      std::string_view view;
+      datastream<const char*> vds( packed.data(), packed.size() );
+      raw::unpack( vds, view );
+      BOOST_CHECK_EQUAL( view, s );
+      BOOST_CHECK( view.empty() || view.data() == packed.data() + packed.size() - s.size() );
+      BOOST_CHECK_EQUAL( vds.remaining(), 0u );
+   }
+} FC_LOG_AND_RETHROW()
+
+// a length beyond the input is rejected before the destination is resized
+BOOST_AUTO_TEST_CASE( short_read_leaves_destination ) try {
+   for( const auto& packed : { truncated( 10, 3 ), truncated( 1000000, 0 ), truncated( 1, 0 ) } ) {
+      std::string str = "previous";
+      datastream<const char*> ds( packed.data(), packed.size() );
+      BOOST_CHECK_THROW( raw::unpack( ds, str ), fc::out_of_range_exception );
+      BOOST_CHECK_EQUAL( str, "previous" );
+
+      std::string_view view = "previous";
+      datastream<const char*> vds( packed.data(), packed.size() );
+      BOOST_CHECK_THROW( raw::unpack( vds, view ), fc::out_of_range_exception );
+      BOOST_CHECK_EQUAL( view, "previous" );
+
+      std::vector<char> bytes = { 'p' };
+      datastream<const char*> bds( packed.data(), packed.size() );
+      BOOST_CHECK_THROW( raw::unpack( bds, bytes ), fc::out_of_range_exception );
+      BOOST_CHECK( bytes == std::vector<char>{ 'p' } );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
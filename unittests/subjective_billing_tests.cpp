@@ -0,0 +1,104 @@
+#include <inery/chain/subjective_billing.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+
+BOOST_AUTO_TEST_SUITE(subjective_billing_tests)
+
+BOOST_AUTO_TEST_CASE( decay ) try {
+   subjective_billing sub_bill;
+   const fc::time_point now = fc::time_point( fc::seconds( 1577836800 ) ); // 2020-01-01T00:00:00
+   const fc::microseconds window = fc::milliseconds( config::account_cpu_usage_average_window_ms );
+   const fc::microseconds half_window = fc::milliseconds( config::account_cpu_usage_average_window_ms / 2 );
+   const account_name a = N(alice), b = N(bob), c = N(carol);
+
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ a, b }, fc::microseconds( 1000 ), now );
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ a }, fc::microseconds( 1000 ), now );
+   BOOST_CHECK_EQUAL( sub_bill.size(), 2u );
+   // the accumulator rounds up by at most one microsecond
+   BOOST_CHECK_LE( sub_bill.get_subjective_bill( a, now ) - 2000, 1 );
+   BOOST_CHECK_LE( sub_bill.get_subjective_bill( b, now ) - 1000, 1 );
+   BOOST_CHECK_EQUAL( sub_bill.get_subjective_bill( c, now ), 0 );
+
+   // linear decay over the window
+   const int64_t half = sub_bill.get_subjective_bill( a, now + half_window );
+   BOOST_CHECK_GE( half, 1000 );
+   BOOST_CHECK_LE( half, 1001 );
+   BOOST_CHECK_EQUAL( sub_bill.get_subjective_bill( a, now + window ), 0 );
+
+   // charges made later decay from their own time
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ b }, fc::microseconds( 1000 ), now + half_window );
+   const int64_t b_bill = sub_bill.get_subjective_bill( b, now + half_window );
+   BOOST_CHECK_GE( b_bill, 1500 );
+   BOOST_CHECK_LE( b_bill, 1502 );
+
+   sub_bill.remove_expired( now + window, fc::time_point::maximum() );
+   BOOST_CHECK_EQUAL( sub_bill.size(), 1u );
+   sub_bill.remove_expired( now + window + window, fc::time_point::maximum() );
+   BOOST_CHECK_EQUAL( sub_bill.size(), 0u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( clock_going_back ) try {
+   subjective_billing sub_bill;
+   const fc::time_point now = fc::time_point( fc::seconds( 1577836800 ) ); // 2020-01-01T00:00:00
+   const account_name a = N(alice);
+
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ a }, fc::microseconds( 1000 ), now + fc::seconds( 10 ) );
+   // a wall clock step back must not throw; the charge counts as made at the latest time seen
+   BOOST_CHECK_NO_THROW( sub_bill.subjective_bill_failed( flat_set<account_name>{ a }, fc::microseconds( 1000 ), now ) );
+   const int64_t bill = sub_bill.get_subjective_bill( a, now + fc::seconds( 10 ) );
+   BOOST_CHECK_GE( bill, 2000 );
+   BOOST_CHECK_LE( bill, 2001 );
+   // reading the bill at an earlier time does not decay it
+   BOOST_CHECK_EQUAL( sub_bill.get_subjective_bill( a, now ), bill );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( disabled ) try {
+   subjective_billing sub_bill;
+   sub_bill.disable();
+   const fc::time_point now = fc::time_point( fc::seconds( 1577836800 ) ); // 2020-01-01T00:00:00
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ N(alice) }, fc::microseconds( 1000 ), now );
+   BOOST_CHECK_EQUAL( sub_bill.size(), 0u );
+   BOOST_CHECK_EQUAL( sub_bill.get_subjective_bill( N(alice), now ), 0 );
+} FC_LOG_AND_RETHROW()
+
+// the subjective bill is checked against the cpu resource_limits_manager leaves the account after its billed usage
+BOOST_AUTO_TEST_CASE( check_against_resource_limits ) try {
+   fc::temp_directory tempdir;
+   chainbase::database db( tempdir.path(), chainbase::database::read_write, 1024*1024*8 );
+   resource_limits::resource_limits_manager rlm( db );
+   rlm.add_indices();
+   rlm.initialize_database();
+   const account_name a = N(alice), b = N(bob), c = N(carol);
+   for( const auto& n : { a, b } )
+      rlm.initialize_account( n );
+   // alice gets a small share of the cpu, so that her limit is finite and small
+   rlm.set_account_limits( a, -1, -1, 1 );
+   rlm.set_account_limits( b, -1, -1, 999 );
+   rlm.process_account_limit_updates();
+
+   subjective_billing sub_bill;
+   const fc::time_point now = fc::time_point( fc::seconds( 1577836800 ) ); // 2020-01-01T00:00:00
+   const int64_t available = rlm.get_account_cpu_limit_ex( a ).first.available;
+   BOOST_REQUIRE_GT( available, 1000 );
+
+   sub_bill.subjective_bill_failed( flat_set<account_name>{ a }, fc::microseconds( available - 500 ), now );
+   BOOST_CHECK_NO_THROW( sub_bill.check( rlm, a, now ) );
+
+   // cpu billed on chain leaves less room for the subjective bill
+   rlm.add_transaction_usage( flat_set<account_name>{ a }, 1000, 0, 1 );
+   BOOST_CHECK_LT( rlm.get_account_cpu_limit_ex( a ).first.available, available - 500 );
+   BOOST_CHECK_THROW( sub_bill.check( rlm, a, now ), tx_cpu_usage_exceeded );
+
+   // once the bill decays below what is available the account may transact again
+   BOOST_CHECK_NO_THROW( sub_bill.check( rlm, a, now + fc::milliseconds( config::account_cpu_usage_average_window_ms / 2 ) ) );
+
+   // accounts without a subjective bill are not limited by it
+   BOOST_CHECK_NO_THROW( sub_bill.check( rlm, b, now ) );
+   BOOST_CHECK_NO_THROW( sub_bill.check( rlm, c, now ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
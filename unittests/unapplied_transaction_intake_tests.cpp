@@ -0,0 +1,117 @@
+#include <inery/chain/unapplied_transaction_intake.hpp>
+#include <inery/chain/contract_types.hpp>
+#include <inery/chain/thread_utils.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <future>
+
+using namespace inery::chain;
+
+namespace {
+
+packed_transaction_ptr unique_trx( fc::time_point expire = fc::time_point::now() + fc::seconds( 120 ) ) {
+   static uint64_t nextid = 0;
+   ++nextid;
+   signed_transaction trx;
+   trx.expiration = expire;
+   trx.actions.emplace_back( vector<permission_level>{{config::system_account_name, config::active_name}},
+                             onerror{ nextid, "test", 4 } );
+   return std::make_shared<packed_transaction>( std::move( trx ) );
+}
+
+/// runs everything posted to pool before this call
+void wait_for_pool( named_thread_pool& pool ) {
+   std::promise<void> done;
+   boost::asio::post( pool.get_executor(), [&]() { done.set_value(); } );
+   done.get_future().wait();
+}
+
+using intake_type = unapplied_transaction_intake<int>;
+
+const chain_id_type test_chain_id( "0000000000000000000000000000000000000000000000000000000000000000" );
+
+std::vector<int> drain_payloads( intake_type& intake, size_t max_batch ) {
+   std::vector<int> result;
+   intake.drain( max_batch, [&]( intake_type::entry&& e ) {
+      BOOST_CHECK( e.trx_meta.get()->packed_trx() == e.trx );
+      result.push_back( e.payload );
+   } );
+   return result;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(unapplied_transaction_intake_tests)
+
+BOOST_AUTO_TEST_CASE( drain_in_arrival_order ) try {
+   named_thread_pool pool( "intake", 1 );
+   intake_type intake( pool.get_executor(), test_chain_id, fc::seconds( 1 ), UINT32_MAX );
+
+   for( int i = 0; i < 5; ++i )
+      BOOST_CHECK( intake.push( unique_trx(), i ) == intake_type::push_result::queued );
+   BOOST_CHECK_EQUAL( intake.size(), 5u );
+   wait_for_pool( pool );
+
+   BOOST_CHECK( drain_payloads( intake, 2 ) == std::vector<int>({ 0, 1 }) );
+   BOOST_CHECK_EQUAL( intake.size(), 3u );
+
+   intake.push( unique_trx(), 5 );
+   wait_for_pool( pool );
+   BOOST_CHECK( drain_payloads( intake, 10 ) == std::vector<int>({ 2, 3, 4, 5 }) );
+   BOOST_CHECK_EQUAL( intake.size(), 0u );
+   BOOST_CHECK( drain_payloads( intake, 10 ).empty() );
+
+   pool.stop();
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( keeps_entries_still_recovering_keys ) try {
+   named_thread_pool pool( "intake", 1 );
+   intake_type intake( pool.get_executor(), test_chain_id, fc::seconds( 1 ), UINT32_MAX );
+
+   // key recovery of everything pushed below waits behind gate
+   std::promise<void> gate;
+   auto opened = gate.get_future().share();
+   boost::asio::post( pool.get_executor(), [opened]() { opened.wait(); } );
+
+   for( int i = 0; i < 3; ++i )
+      intake.push( unique_trx(), i );
+   BOOST_CHECK_EQUAL( intake.drain( 10, []( intake_type::entry&& ) { BOOST_FAIL( "entry is not ready" ); } ), 0u );
+   BOOST_CHECK_EQUAL( intake.size(), 3u );
+
+   gate.set_value();
+   wait_for_pool( pool );
+   intake.push( unique_trx(), 3 );
+   wait_for_pool( pool );
+   BOOST_CHECK( drain_payloads( intake, 10 ) == std::vector<int>({ 0, 1, 2, 3 }) );
+
+   pool.stop();
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( rejects_duplicate_and_expired ) try {
+   named_thread_pool pool( "intake", 1 );
+   intake_type intake( pool.get_executor(), test_chain_id, fc::seconds( 1 ), UINT32_MAX );
+
+   auto trx = unique_trx();
+   BOOST_CHECK( intake.push( trx, 0 ) == intake_type::push_result::queued );
+   BOOST_CHECK( intake.push( trx, 1 ) == intake_type::push_result::duplicate );
+   BOOST_CHECK_EQUAL( intake.duplicates(), 1u );
+
+   const auto now = fc::time_point::now();
+   BOOST_CHECK( intake.push( unique_trx( now ), 2, now ) == intake_type::push_result::expired );
+   BOOST_CHECK_EQUAL( intake.expired(), 1u );
+
+   wait_for_pool( pool );
+   BOOST_CHECK( drain_payloads( intake, 10 ) == std::vector<int>({ 0 }) );
+
+   // forgotten ids are accepted again
+   BOOST_CHECK( intake.push( trx, 3 ) == intake_type::push_result::duplicate );
+   intake.forget( trx->id() );
+   BOOST_CHECK( intake.push( trx, 4 ) == intake_type::push_result::queued );
+   wait_for_pool( pool );
+   BOOST_CHECK( drain_payloads( intake, 10 ) == std::vector<int>({ 4 }) );
+
+   pool.stop();
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,169 @@
+#include <inery/chain/unapplied_transaction_queue.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace inery::chain;
+
+namespace {
+
+transaction_trace make_trace( const vector<action>& acts, uint32_t cpu_usage_us ) {
+   transaction_trace trace;
+   trace.receipt = transaction_receipt_header( transaction_receipt_header::executed );
+   trace.receipt->cpu_usage_us = cpu_usage_us;
+   for( const auto& a : acts ) {
+      action_trace at;
+      at.act = a;
+      at.receiver = a.account;
+      trace.action_traces.push_back( at );
+      // a notification of the top-level action, which must not count as another action
+      action_trace notified = at;
+      notified.receiver = N(notified);
+      notified.creator_action_ordinal = 1;
+      trace.action_traces.push_back( notified );
+   }
+   return trace;
+}
+
+action make_action( account_name actor, action_name act_name ) {
+   return action( vector<permission_level>{{actor, config::active_name}}, N(test), act_name, bytes() );
+}
+
+transaction_metadata_ptr make_trx( account_name actor, action_name act_name, uint32_t expires_in_sec = 120 ) {
+   static uint32_t nextid = 0;
+   signed_transaction trx;
+   trx.expiration = fc::time_point::now() + fc::seconds( expires_in_sec );
+   trx.ref_block_num = ++nextid; // unique id
+   trx.actions.push_back( make_action( actor, act_name ) );
+   return transaction_metadata::create_no_recover_keys( packed_transaction( std::move( trx ) ),
+                                                        transaction_metadata::trx_type::input );
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(unapplied_transaction_queue_tests)
+
+BOOST_AUTO_TEST_CASE( cpu_estimator_average ) try {
+   action_cpu_estimator est( 150, 16 );
+   signed_transaction trx;
+   trx.actions.push_back( make_action( N(alice), N(transfer) ) );
+   BOOST_CHECK_EQUAL( est.estimate( trx ), 150u );
+
+   // billed cpu is split evenly over the top-level actions
+   est.record( make_trace( { make_action( N(alice), N(transfer) ), make_action( N(alice), N(issue) ) }, 1000 ) );
+   BOOST_CHECK_EQUAL( est.size(), 2u );
+   BOOST_CHECK_EQUAL( est.estimate( trx ), 500u );
+
+   // new samples are weighted 1/8
+   est.record( make_trace( { make_action( N(alice), N(transfer) ) }, 1300 ) );
+   BOOST_CHECK_EQUAL( est.estimate( trx ), 600u );
+
+   trx.actions.push_back( make_action( N(bob), N(unknown) ) );
+   BOOST_CHECK_EQUAL( est.estimate( trx ), 750u );
+
+   // failed transactions are not recorded
+   auto failed = make_trace( { make_action( N(alice), N(failed) ) }, 1000 );
+   failed.receipt.reset();
+   est.record( failed );
+   BOOST_CHECK_EQUAL( est.size(), 2u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( cpu_estimator_evicts_least_recently_recorded ) try {
+   action_cpu_estimator est( 150, 2 );
+   auto estimate_of = [&]( action_name n ) {
+      signed_transaction trx;
+      trx.actions.push_back( make_action( N(alice), n ) );
+      return est.estimate( trx );
+   };
+
+   est.record( make_trace( { make_action( N(alice), N(a) ) }, 1000 ) );
+   est.record( make_trace( { make_action( N(alice), N(b) ) }, 2000 ) );
+   est.record( make_trace( { make_action( N(alice), N(a) ) }, 1000 ) );
+   est.record( make_trace( { make_action( N(alice), N(c) ) }, 3000 ) );
+
+   BOOST_CHECK_EQUAL( est.size(), 2u );
+   BOOST_CHECK_EQUAL( estimate_of( N(a) ), 1000u );
+   BOOST_CHECK_EQUAL( estimate_of( N(b) ), 150u ); // evicted
+   BOOST_CHECK_EQUAL( estimate_of( N(c) ), 3000u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( schedule_by_priority ) try {
+   unapplied_transaction_queue q;
+   q.record_trace( make_trace( { make_action( N(alice), N(cheap) ) }, 100 ) );
+   q.record_trace( make_trace( { make_action( N(alice), N(costly) ) }, 600 ) );
+
+   auto x1 = make_trx( N(alice), N(costly) );
+   auto x2 = make_trx( N(alice), N(costly) );
+   auto y1 = make_trx( N(bob), N(costly) );
+   auto b0 = make_trx( N(bob), N(cheap) );
+   auto p0 = make_trx( N(carol), N(cheap) );
+   q.add_aborted( { x1, x2, y1, b0 } );
+   q.add_persisted( p0 );
+
+   // each account may use 1000us: alice's second costly trx waits until bob was served
+   std::vector<transaction_metadata_ptr> order;
+   account_cpu_quota quota;
+   quota.start_block( 2000, 50 * config::percent_1 );
+   q.schedule_by_priority( quota, fc::time_point(), [&]( unapplied_transaction_queue::priority_iterator itr ) {
+      order.push_back( itr->trx_meta );
+      return std::make_pair( true, itr->estimated_cpu_us );
+   } );
+   BOOST_REQUIRE_EQUAL( order.size(), 4u );
+   BOOST_CHECK( order[0] == b0 );
+   BOOST_CHECK( order[1] == x1 );
+   BOOST_CHECK( order[2] == y1 );
+   BOOST_CHECK( order[3] == x2 );
+
+   // f ends scheduling by returning false, and may erase what it visited
+   order.clear();
+   quota.start_block( 2000, 50 * config::percent_1 );
+   q.schedule_by_priority( quota, fc::time_point(), [&]( unapplied_transaction_queue::priority_iterator itr ) {
+      order.push_back( itr->trx_meta );
+      q.erase( itr );
+      return std::make_pair( order.size() < 2, 0u );
+   } );
+   BOOST_REQUIRE_EQUAL( order.size(), 2u );
+   BOOST_CHECK( order[0] == b0 );
+   BOOST_CHECK( order[1] == x1 );
+   BOOST_CHECK_EQUAL( q.size(), 3u );
+   BOOST_CHECK( q.is_persisted( p0 ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( schedule_by_priority_ages_expiring ) try {
+   unapplied_transaction_queue q;
+   q.record_trace( make_trace( { make_action( N(alice), N(cheap) ) }, 100 ) );
+   q.record_trace( make_trace( { make_action( N(alice), N(costly) ) }, 600 ) );
+
+   auto c1 = make_trx( N(bob), N(cheap) );
+   auto c2 = make_trx( N(carol), N(cheap) );
+   auto x0 = make_trx( N(alice), N(costly), 30 );
+   auto x1 = make_trx( N(alice), N(costly), 20 );
+   q.add_aborted( { c1, c2, x0, x1 } );
+
+   auto schedule = [&]( const fc::time_point& expiring_before ) {
+      std::vector<transaction_metadata_ptr> order;
+      account_cpu_quota quota;
+      quota.start_block( 2000 );
+      q.schedule_by_priority( quota, expiring_before, [&]( unapplied_transaction_queue::priority_iterator itr ) {
+         order.push_back( itr->trx_meta );
+         return std::make_pair( true, itr->estimated_cpu_us );
+      } );
+      return order;
+   };
+
+   // without aging the costly trxs wait behind every cheap one; alice's second exceeds the default 20% quota
+   auto order = schedule( fc::time_point() );
+   BOOST_REQUIRE_EQUAL( order.size(), 4u );
+   BOOST_CHECK( order[0] == c1 || order[0] == c2 );
+   BOOST_CHECK( order[1] == c1 || order[1] == c2 );
+   BOOST_CHECK( order[2] == x0 || order[2] == x1 );
+
+   // close to expiry they go first, soonest expiry first, even beyond the quota
+   order = schedule( fc::time_point::now() + fc::seconds( 60 ) );
+   BOOST_REQUIRE_EQUAL( order.size(), 4u );
+   BOOST_CHECK( order[0] == x1 );
+   BOOST_CHECK( order[1] == x0 );
+   BOOST_CHECK( order[2] == c1 || order[2] == c2 );
+   BOOST_CHECK( order[3] == c1 || order[3] == c2 );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+
+#include <inery/vm/leb128.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+using namespace inery::vm;
+
+namespace {
+
+/// a stream that is not in memory as far as fc::raw is concerned, so it is read through the byte loop
+struct byte_stream {
+   const char* pos;
+   const char* end;
+
+   bool get( char& c ) {
+      BOOST_REQUIRE( pos < end );
+      c = *pos++;
+      return true;
+   }
+   bool read( char* d, size_t s ) {
+      BOOST_REQUIRE( size_t( end - pos ) >= s );
+      memcpy( d, pos, s );
+      pos += s;
+      return true;
+   }
+};
+
+/// random bytes, mostly with the continuation bit set, then zeros that end any varint
+std::vector<char> random_input( size_t size ) {
+   std::mt19937 rng( 17 );
+   std::vector<char> result( size + 16, 0 );
+   for( size_t i = 0; i < size; ++i ) {
+      const uint8_t b = uint8_t( rng() );
+      result[i] = char( rng() % 4 ? b | 0x80 : b & 0x7f );
+   }
+   return result;
+}
+
+const uint32_t interesting[] = { 0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0xfffffff, 0x10000000, 0x7fffffff, 0x80000000, 0xffffffff };
+
+/// the LEB128 encoding of v in exactly len bytes, padded with continuation bytes
+std::vector<uint8_t> leb128( uint64_t v, size_t len ) {
+   std::vector<uint8_t> result;
+   for( size_t i = 0; i < len; ++i, v >>= 7 )
+      result.push_back( uint8_t( v & 0x7f ) | ( i + 1 < len ? 0x80 : 0 ) );
+   return result;
+}
+
+/// the length of the shortest encoding of v
+size_t min_length( uint64_t v ) {
+   size_t len = 1;
+   while( v >> ( 7 * len ) )
+      ++len;
+   return len;
+}
+
+/// decodes input at every offset, with at least and with fewer than 8 bytes after it
+template<typename V>
+void check_vm_decode( const std::vector<uint8_t>& encoding, uint32_t expected ) {
+   for( size_t tail : { 0, 3, 16 } ) {
+      std::vector<uint8_t> code( encoding );
+      code.resize( encoding.size() + tail, 0 );
+      guarded_ptr<uint8_t> p( code.data(), code.size() );
+      V v( p );
+      BOOST_CHECK_EQUAL( v.size(), encoding.size() );
+      BOOST_CHECK_EQUAL( p.offset(), encoding.size() );
+      BOOST_CHECK_EQUAL( uint32_t( v.template to<>() ), expected );
+   }
+}
+
+template<typename V, typename E>
+void check_vm_rejects( const std::vector<uint8_t>& encoding ) {
+   for( size_t tail : { 0, 3, 16 } ) {
+      std::vector<uint8_t> code( encoding );
+      code.resize( encoding.size() + tail, 0 );
+      guarded_ptr<uint8_t> p( code.data(), code.size() );
+      BOOST_CHECK_THROW( V v( p ), E );
+   }
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(varint_tests)
+
+// the word-at-a-time decoding of memory datastreams matches the byte loop of other streams
+BOOST_AUTO_TEST_CASE( fc_matches_byte_loop ) try {
+   const std::vector<char> input = random_input( 4096 );
+   for( size_t offset = 0; offset < input.size() - 16; ++offset ) {
+      const char* begin = input.data() + offset;
+      const char* end = input.data() + input.size();
+
+      fc::unsigned_int u, expected_u;
+      fc::datastream<const char*> ds( begin, end - begin );
+      byte_stream bs{ begin, end };
+      fc::raw::unpack( ds, u );
+      fc::raw::unpack( bs, expected_u );
+      BOOST_CHECK_EQUAL( u.value, expected_u.value );
+      BOOST_CHECK_EQUAL( ds.pos(), bs.pos );
+
+      fc::signed_int s, expected_s;
+      fc::datastream<const char*> sds( begin, end - begin );
+      byte_stream sbs{ begin, end };
+      fc::raw::unpack( sds, s );
+      fc::raw::unpack( sbs, expected_s );
+      BOOST_CHECK_EQUAL( s.value, expected_s.value );
+      BOOST_CHECK_EQUAL( sds.pos(), sbs.pos );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( fc_round_trip ) try {
+   for( uint32_t v : interesting ) {
+      const std::vector<char> packed = fc::raw::pack( fc::unsigned_int( v ) );
+      const std::vector<uint8_t> expected = leb128( v, min_length( v ) );
+      BOOST_CHECK( std::equal( packed.begin(), packed.end(), expected.begin(), expected.end(),
+                               []( char a, uint8_t b ) { return uint8_t( a ) == b; } ) );
+      // at the end of the input, and followed by more
+      std::vector<char> padded( packed );
+      padded.resize( packed.size() + 8, char( 0x80 ) );
+      for( const std::vector<char>& in : { packed, padded } ) {
+         fc::datastream<const char*> ds( in.data(), in.size() );
+         fc::unsigned_int u;
+         fc::raw::unpack( ds, u );
+         BOOST_CHECK_EQUAL( u.value, v );
+         BOOST_CHECK_EQUAL( ds.tellp(), packed.size() );
+      }
+
+      const int32_t sv = int32_t( v );
+      const std::vector<char> spacked = fc::raw::pack( fc::signed_int( sv ) );
+      BOOST_CHECK_EQUAL( fc::raw::unpack<fc::signed_int>( spacked ).value, sv );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( vm_decodes_every_length ) try {
+   for( uint32_t v : interesting ) {
+      for( size_t len = min_length( v ); len <= 5; ++len )
+         check_vm_decode<varuint<32>>( leb128( v, len ), v );
+      const int32_t sv = int32_t( v );
+      check_vm_decode<varint<32>>( leb128( uint64_t( int64_t( sv ) ), 5 ), uint32_t( sv ) );
+   }
+   check_vm_decode<varuint<7>>( leb128( 0x55, 1 ), 0x55 );
+   check_vm_decode<varuint<1>>( leb128( 1, 1 ), 1 );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( vm_rejects_bad_encodings ) try {
+   // too long
+   check_vm_rejects<varuint<32>, wasm_interpreter_exception>( leb128( 1, 6 ) );
+   check_vm_rejects<varint<32>, wasm_interpreter_exception>( leb128( 1, 6 ) );
+   check_vm_rejects<varuint<7>, wasm_interpreter_exception>( leb128( 1, 2 ) );
+   // bits beyond the 32nd
+   check_vm_rejects<varuint<32>, wasm_parse_exception>( leb128( uint64_t( 1 ) << 32, 5 ) );
+   check_vm_rejects<varint<32>, wasm_parse_exception>( leb128( uint64_t( 1 ) << 31, 5 ) );
+
+   // cut off by the end of the code
+   std::vector<uint8_t> code = leb128( 0x4000, 3 );
+   guarded_ptr<uint8_t> p( code.data(), 2 );
+   BOOST_CHECK_THROW( varuint<32> v( p ), wasm_interpreter_exception );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()